@@ -4,6 +4,8 @@
 #include <memory>
 #include <ostream>
 
+#include "buffer_pool.h"
+
 class Buffer
 {
   public:
@@ -89,7 +91,8 @@ class Buffer
     // Length of contents in buffer.
     size_t buffer_length;
     size_t buffer_capacity;
-    std::unique_ptr<char[]> buffer;
+    // Storage is taken from BufferPool and returned on destruction.
+    std::unique_ptr<char[], BufferPool::Deleter> buffer;
     size_t index_position;
 };
 
@@ -0,0 +1,51 @@
+#ifndef _BUFFER_POOL_H
+#define _BUFFER_POOL_H
+
+#include <cstddef>
+
+#include "units.h"
+
+/**
+ * Fixed-size slabs for Buffer storage. Each thread keeps a free list per
+ * slab size, surplus slabs are moved to a shared depot which refills free
+ * lists of other threads, so buffers released on another thread are reused
+ * too. Capacities above kMaxSlabSize are allocated from heap.
+ */
+class BufferPool
+{
+  public:
+    constexpr static size_t kMinSlabSize = 4_KB;
+    constexpr static size_t kMaxSlabSize = 1_MB;
+    // Free slabs kept by each thread per slab size.
+    constexpr static size_t kMaxLocalSlabs = 32;
+
+    struct Stats {
+      // Slabs and large buffers allocated from heap.
+      size_t heap_allocations = 0;
+      // Slabs taken from free lists or depot.
+      size_t reused_slabs = 0;
+    };
+
+    // Returns storage to pool, used as deleter of buffer storage.
+    struct Deleter {
+      size_t capacity = 0;
+      void operator()(char* data) const;
+    };
+
+    /**
+     * Allocates zero-filled storage of at least capacity bytes.
+     *
+     * @throws std::bad_alloc in case of failure.
+     */
+    static char* allocate(size_t capacity);
+
+    // Releases storage allocated with the same capacity.
+    static void deallocate(char* data, size_t capacity) noexcept;
+
+    // Size of slab used for capacity, 0 if it's allocated from heap.
+    static size_t get_slab_size(size_t capacity) noexcept;
+
+    static Stats get_stats();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef _CHUNKED_DECODER_H
+#define _CHUNKED_DECODER_H
+
+#include <cstddef>
+
+/**
+ * Streaming decoder of chunked transfer coding. Chunk framing is removed in
+ * place, state is kept between calls so framing may be split at any byte.
+ */
+class ChunkedDecoder
+{
+  public:
+    enum class State {
+      SIZE,
+      // Chunk extension, ignored.
+      EXTENSION,
+      SIZE_LF,
+      DATA,
+      DATA_CR,
+      DATA_LF,
+      TRAILER_START,
+      TRAILER,
+      TRAILER_LF,
+      FINISHED,
+      ERROR
+    };
+
+    ChunkedDecoder();
+
+    /**
+     * Decodes next received bytes of body.
+     *
+     * @param data Received bytes, replaced by decoded ones.
+     * @return Number of decoded bytes at the beginning of data.
+     */
+    size_t decode(char* data, size_t length);
+
+    void reset();
+
+    State get_state() const noexcept;
+    // True when last chunk and trailer are received.
+    bool is_finished() const noexcept;
+    bool has_error() const noexcept;
+
+  private:
+    State state;
+    size_t chunk_size;
+    size_t size_digits;
+    // Bytes of current chunk which are not received yet.
+    size_t remaining_bytes;
+};
+
+#endif
@@ -3,10 +3,14 @@
 
 #include <memory>
 #include <chrono>
+#include <vector>
 
 #include <openssl/bio.h>
 
+#include "buffer.h"
 #include "socket_ops.h"
+#include "chunked_decoder.h"
+#include "http_response_parser.h"
 #include "state_manager.h"
 
 enum class OperationStatus {
@@ -20,21 +24,41 @@ enum class OperationStatus {
   FTP_ERROR,
   SSL_ERROR,
   RESPONSE_ERROR,
+  // File is changed on server while downloading.
+  FILE_CHANGED,
   SOCKFD_ERROR,
   SOCKET_SEND_ERROR,
   SOCKET_RECV_ERROR,
   SOCKET_CONNECT_ERROR
 };
 
+// Received body in an io_uring buffer which is written to output file.
+struct UringWrite {
+  const char* data = nullptr;
+  size_t length = 0;
+  size_t position = 0;
+};
+
 struct Connection {
   Connection() : status(OperationStatus::NOT_STARTED)
     , bio(nullptr)
     , ssl(nullptr)
     , last_recv_time_point(std::chrono::steady_clock::now())
+    , request_time_point(last_recv_time_point)
+    , recvd_bytes(0)
+    , body_bytes(0)
 //    , http_proxy(nullptr)
     , header_skipped(false)
     , inited(false)
     , request_sent(false)
+    , keep_alive(true)
+    , end_of_body(false)
+    , io_buffers_in_use(0)
+    , recv_in_flight(false)
+    , write_in_flight(false)
+    , write_queued(false)
+    , queued_write_slot(0)
+    , retries(0)
   {
   }
 
@@ -54,11 +78,39 @@ struct Connection {
   // Used for ftp media channel.
   std::unique_ptr<SocketOps> ftp_media_socket_ops;
   std::chrono::steady_clock::time_point last_recv_time_point;
+  // Used for measuring throughput and round-trip time of connection.
+  std::chrono::steady_clock::time_point request_time_point;
+  std::chrono::steady_clock::time_point first_recv_time_point;
+  size_t recvd_bytes;
+  // Body bytes of response received so far, framing excluded.
+  size_t body_bytes;
   std::string temp_http_header;
+  // Keeps state of response header between receives.
+  HttpResponseParser response_parser;
+  ChunkedDecoder chunked_decoder;
   //std::unique_ptr<HttpProxy> http_proxy;
   bool header_skipped;
   bool inited;
   bool request_sent;
+  // False if server closes connection or response has unread data.
+  bool keep_alive;
+  // Set when end of response body is received.
+  bool end_of_body;
+  // Used by io_uring engine, buffers of in-flight receive and write
+  // operations. Bit i of io_buffers_in_use is set while io_buffers[i] is
+  // owned by kernel.
+  std::vector<Buffer> io_buffers;
+  uint32_t io_buffers_in_use;
+  bool recv_in_flight;
+  // Writes of io_buffers. One write of connection is in flight at a time,
+  // so writes of a part complete in order, next one waits in
+  // queued_write_slot.
+  std::vector<UringWrite> io_writes;
+  bool write_in_flight;
+  bool write_queued;
+  size_t queued_write_slot;
+  // Number of times part is requested again after a failed response.
+  size_t retries;
 };
 
 #endif
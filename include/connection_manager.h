@@ -1,11 +1,28 @@
 #ifndef _CONNECTIONION_MANAGER_HH
 #define _CONNECTIONION_MANAGER_HH
 
+#include <mutex>
 #include <memory>
+#include <vector>
 
+#include "buffer.h"
 #include "url_parser.h"
 #include "socket_ops.h"
 #include "transceiver.h"
+#include "http_response_parser.h"
+
+/**
+ * Response of the request which checked the link. Its body starts at first
+ * byte of file, so it is used as the first part of download.
+ */
+struct ProbeResponse
+{
+  // nullptr if response can't be used, e.g. ftp.
+  std::unique_ptr<SocketOps> sock_ops;
+  HttpResponseParser parser;
+  // Body bytes received along with header.
+  Buffer body;
+};
 
 class ConnectionManager
 {
@@ -17,12 +34,53 @@ class ConnectionManager
     // 0: unknown file length.
     std::string get_file_name() const;
     size_t get_file_length() const;
+    // False if server ignores Range and sends whole file to every request.
+    bool supports_ranges() const;
+    // Validators of file, empty if server doesn't send them.
+    std::string get_etag() const;
+    std::string get_last_modified() const;
+    /**
+     * Validator usable in If-Range, strong ETag or else Last-Modified.
+     * Empty if server sends neither.
+     */
+    std::string get_validator() const;
     std::string get_host_name() const;
     uint16_t get_port() const;
     int get_one_socket_descriptor();
+    /**
+     * Returns an idle connection of pool if available, otherwise connects a
+     * new one. Thread safe.
+     */
     std::unique_ptr<SocketOps> acquire_sock_ops();
 
+    /**
+     * Returns an idle connection of pool, nullptr if pool is empty.
+     * Thread safe.
+     */
+    std::unique_ptr<SocketOps> acquire_idle_sock_ops();
+
+    /**
+     * Creates socket ops of protocol without connecting it.
+     */
+    std::unique_ptr<SocketOps> create_sock_ops() const;
+
+    /**
+     * Returns a connection whose last response is finished to pool of idle
+     * connections of the host. Thread safe.
+     *
+     * @param sock_ops Connected socket in blocking mode.
+     */
+    void release_sock_ops(std::unique_ptr<SocketOps> sock_ops);
+
+    /**
+     * Hands over connection of link check with its unread response, it can
+     * be taken once.
+     */
+    ProbeResponse take_probe_response();
+
   private:
+    constexpr static size_t kMaxIdleConnections = 16;
+
     std::unique_ptr<SocketOps> get_socket_ops();
     std::pair<bool, std::string> check_link();
     std::string get_ip(const std::string& host_name) const;
@@ -31,7 +89,13 @@ class ConnectionManager
     UrlParser url_parser;
     std::string ip;
     size_t file_length;
+    bool ranges_supported;
+    std::string etag;
+    std::string last_modified;
     std::unique_ptr<SocketOps> socket_ops;
+    ProbeResponse probe_response;
+    std::mutex idle_sock_ops_mutex;
+    std::vector<std::unique_ptr<SocketOps>> idle_sock_ops;
 };
 
 #endif
@@ -9,7 +9,11 @@
 
 #include "thread.h"
 #include "file_io.h"
+#include "file_writer.h"
 #include "connection.h"
+#include "event_loop.h"
+#include "uring_queue.h"
+#include "wakeup_event.h"
 #include "socket_ops.h"
 #include "http_proxy.h"
 #include "state_manager.h"
@@ -19,6 +23,13 @@
 
 using CallBack = std::function<void(size_t)>;
 
+enum class IoEngine {
+  // Readiness based receive and synchronous file writes.
+  EPOLL,
+  // Batched recv and positioned write submissions, plain sockets only.
+  IO_URING
+};
+
 class Downloader : public Thread {
   public:
     const static std::string HTTP_HEADER;
@@ -47,20 +58,105 @@ class Downloader : public Thread {
 
     void set_download_parts(std::queue<std::pair<size_t, Chunk>> initial_parts);
 
-    void set_parts(uint16_t parts);
+    void set_parts(size_t parts);
+
+    /**
+     * Selects i/o engine of download loop.
+     * Falls back to IoEngine::EPOLL if io_uring is not available.
+     */
+    void set_io_engine(IoEngine io_engine);
+
+    /**
+     * Set bounds of chunk size adapted to throughput of connections.
+     * Adaptation is disabled for single part downloads.
+     */
+    void set_chunk_size_policy(const ChunkSizePolicy& chunk_size_policy);
+
+    // Number of writes waiting in write-behind queue.
+    size_t get_write_queue_depth() const;
+
+    // Contention counters of request and socket handoff queues.
+    QueueStats get_request_queue_stats() const;
+    QueueStats get_socket_queue_stats() const;
+
+    /**
+     * Time from start of download until all parts are receiving, zero if
+     * download never ramped up.
+     */
+    std::chrono::milliseconds get_ramp_up_time() const;
+
+    /**
+     * Status of download after it's finished, OperationStatus::FINISHED or
+     * the error which stopped it.
+     */
+    OperationStatus get_status() const;
 
   private:
     void run() override;
 
-    // Return max_fd
-    int set_descriptors();
+    // Return true if any connection was active.
+    bool wait_ready_connections(Buffer& buffer);
 
+    // Receives from connection until its socket is drained.
     void receive_from_connection(size_t index, Buffer& buffer);
 
+    // Return true if any operation was completed.
+    bool wait_uring_completions();
+
+    void submit_uring_recv(size_t index);
+
+    void on_uring_recv(size_t index, size_t slot, int32_t result);
+
+    // Writes io_writes[slot] or queues it behind in-flight write of
+    // connection.
+    void submit_uring_write(Connection& connection, size_t index, size_t slot);
+
+    void on_uring_write(size_t index, size_t slot, int32_t result);
+
+    /**
+     * Waits until kernel releases buffers of in-flight operations of a
+     * stopped download. Pending receives are ended by shutting down their
+     * sockets, completed writes are still applied to state_manager.
+     */
+    void wait_uring_operations();
+
     void init_connections();
 
     void init_connection();
 
+    void init_connection(const std::pair<size_t, Chunk>& part);
+
+    /**
+     * Receives part from connection of link check instead of requesting it.
+     * Body bytes received along with header are written at once.
+     */
+    void init_probe_connection(const std::pair<size_t, Chunk>& part,
+                               ProbeResponse& probe_response);
+
+    /**
+     * Computes size of next chunk from measured throughput and round-trip
+     * time of a finished connection.
+     *
+     * @return Chunk size within policy bounds, 0 if nothing was measured.
+     */
+    size_t adapt_chunk_size(const Connection& connection) const;
+
+    /**
+     * Splits remaining range of the in-flight part with most remaining bytes
+     * and starts a connection for its tail.
+     *
+     * @return false if no part is large enough to split.
+     */
+    bool steal_part();
+
+    /**
+     * Closes connection of a failed response and requests rest of its part
+     * again. Download is stopped after kMaxRetries failures of a part, or at
+     * once if a stream fails after its start or the file is changed
+     * (OperationStatus::FILE_CHANGED).
+     */
+    void retry_connection(size_t index);
+
     struct RateParams {
       size_t limit = 0;
       size_t speed = 0;
@@ -72,38 +168,79 @@ class Downloader : public Thread {
 
     void rate_process(RateParams& rate, size_t recvd_bytes);
 
-    void update_connection_stat(size_t recvd_bytes, size_t index);
+    /**
+     * Parses header and removes transfer framing of a received block in
+     * place.
+     *
+     * @param body Set to first body byte in buffer.
+     * @return Number of body bytes.
+     */
+    size_t extract_body(Buffer& buffer, Connection& connection,
+                        const char*& body);
+
+    // Sets file size of a streaming download once its body is finished.
+    void check_end_of_body(const Connection& connection);
+
+    // Return true if all bytes of chunk are received.
+    bool chunk_finished(const Chunk& chunk) const;
+
+    // Return true if rest of response can't be received from connection.
+    static bool connection_failed(const Connection& connection);
+
+    // Return number of received bytes which belongs to connection's chunk.
+    size_t update_connection_stat(size_t recvd_bytes, size_t index);
+
+    // Records ramp-up time once every part has received data.
+    void check_ramp_up();
+
+    // Applies written parts of file_writer to state_manager.
+    void update_written_parts();
+
+    // Stops download, data which isn't written is never counted as received.
+    void on_write_failed();
 
     void survey_connections();
 
     // <index, socket_ops object>
-    void on_dwl_available(uint16_t index,
+    void on_dwl_available(size_t index,
                           std::unique_ptr<SocketOps> socket_ops);
 
     void check_new_sock_ops();
     
-    fd_set readfds;
     CallBack callback;
-    struct timeval timeout;
+    // Event loop waiting time in milliseconds.
+    int timeout_ms;
     time_t timeout_seconds;
-    uint16_t number_of_parts;
+    size_t number_of_parts;
+    ChunkSizePolicy chunk_size_policy;
+    std::chrono::steady_clock::time_point start_time_point;
+    std::atomic<int64_t> ramp_up_time_ms;
+    OperationStatus status;
     std::unique_ptr<FileIO> file_io;
-    std::mutex new_available_parts_mutex;
+    std::unique_ptr<FileWriter> file_writer;
+    std::vector<FileWriter::WrittenPart> written_parts;
+    std::unique_ptr<EventLoop> event_loop;
+    // Part indices reported by event_loop.
+    std::vector<size_t> ready_parts;
+    IoEngine io_engine;
+    std::unique_ptr<UringQueue> uring;
+    std::vector<UringQueue::Completion> completions;
     // <index, connection> [index: same as part index]
     std::map<size_t, Connection> connections;
     std::unique_ptr<Transceiver> transceiver;
-    std::atomic<bool> wait_first_conn_response;
+    // Notified when new sockets are available.
+    WakeupEvent wakeup_event;
     std::shared_ptr<StateManager> state_manager;
     std::unique_ptr<RequestManager> request_manager;
     // <index, chunk>
     std::queue<std::pair<size_t, Chunk>> initial_parts;
 
     struct NewAvailPart {
-      uint16_t part_index;
+      size_t part_index;
       std::unique_ptr<SocketOps> sock_ops;
     };
-    // part index, socket
-    std::queue<NewAvailPart> new_available_parts;
+    // Sockets handed over by request_manager.
+    std::unique_ptr<MpscQueue<NewAvailPart>> new_available_parts;
 };
 
 #endif
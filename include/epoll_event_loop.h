@@ -0,0 +1,40 @@
+#ifndef _EPOLL_EVENT_LOOP_H
+#define _EPOLL_EVENT_LOOP_H
+
+#include <sys/epoll.h>
+
+#include "event_loop.h"
+
+// Edge-triggered epoll reactor.
+// Note: Reported descriptors should be drained until they would block,
+// otherwise no further event is reported for them.
+class EpollEventLoop : public EventLoop
+{
+  public:
+    /**
+     * C-tor.
+     *
+     * @param max_events Maximum number of events reported by one wait().
+     * @throws std::runtime_error if epoll instance can not be created.
+     */
+    EpollEventLoop(size_t max_events = kDefaultMaxEvents);
+
+    ~EpollEventLoop();
+
+    EpollEventLoop(const EpollEventLoop&) = delete;
+    EpollEventLoop& operator=(const EpollEventLoop&) = delete;
+
+    bool add(int fd, size_t key, bool watch_write = false) override;
+
+    bool remove(int fd) override;
+
+    int wait(std::vector<size_t>& ready_keys, int timeout_ms) override;
+
+    constexpr static size_t kDefaultMaxEvents = 256;
+
+  private:
+    int epoll_fd;
+    std::vector<epoll_event> events;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _EVENT_LOOP_H
+#define _EVENT_LOOP_H
+
+#include <vector>
+#include <cstddef>
+
+// Readiness notification interface used by Downloader and RequestManager.
+class EventLoop
+{
+  public:
+    virtual ~EventLoop() = default;
+
+    /**
+     * Registers a descriptor for read readiness.
+     *
+     * @param fd Descriptor to watch.
+     * @param key Value reported by wait() when fd becomes readable.
+     * @param watch_write Report write readiness too, used while connecting.
+     * @return True if descriptor is registered.
+     */
+    virtual bool add(int fd, size_t key, bool watch_write = false) = 0;
+
+    /**
+     * Unregisters a descriptor, must be called before closing it.
+     *
+     * @return True if descriptor is unregistered.
+     */
+    virtual bool remove(int fd) = 0;
+
+    /**
+     * Waits for readable descriptors.
+     *
+     * @param ready_keys Filled with keys of ready descriptors.
+     * @param timeout_ms Maximum waiting time in milliseconds.
+     * @return Number of ready descriptors, 0 on timeout and -1 on error.
+     */
+    virtual int wait(std::vector<size_t>& ready_keys, int timeout_ms) = 0;
+};
+
+#endif
@@ -2,7 +2,8 @@
 #define _FILE_IO_H
 
 #include <string>
-#include <fstream>
+#include <vector>
+#include <utility>
 
 #include "buffer.h"
 
@@ -16,11 +17,15 @@ enum class PathType
 class FileIO {
 
   public:
-    ~FileIO();
+    virtual ~FileIO();
 
     FileIO(std::string path);
 
-    /// Creates new file.
+    /**
+     * Creates new file.
+     * Storage of file_length bytes is reserved using fallocate, the file is
+     * extended sparsely if file system doesn't support it.
+     */
     virtual void create(size_t file_length = 0);
 
     /// Opens existing file.
@@ -28,20 +33,27 @@ class FileIO {
 
     /**
      * Writes a buffer in the file.
+     * Note: Data is not flushed to the storage.
      *
      * @param buffer Buffer to write in file
      * @param length Length of buffer
      * @param position Position of buffer in file
+     * @return False if buffer is not written completely, e.g. disk is full
+     *  or position is beyond maximum file size.
      */
-    virtual void write(const char* buffer, size_t length, size_t position=0);
+    virtual bool write(const char* buffer, size_t length, size_t position=0);
 
     /**
      * Writes a buffer in the file.
      *
      * @param buffer Buffer to write in file
      * @param position Position of buffer in file
+     * @return False if buffer is not written completely.
      */
-    virtual void write(const Buffer& buffer, size_t position=0);
+    virtual bool write(const Buffer& buffer, size_t position=0);
+
+    /// Flushes written data to the storage device (fdatasync).
+    virtual void sync();
 
     virtual bool check_existence() const;
 
@@ -58,9 +70,39 @@ class FileIO {
 
     virtual void remove();
 
+    /**
+     * Gets size of opened file.
+     *
+     * @return Size in bytes, 0 if file is not open.
+     */
+    virtual size_t get_size() const;
+
+    /**
+     * Finds ranges of opened file which hold data, using SEEK_DATA and
+     * SEEK_HOLE. Holes and preallocated extents which are never written are
+     * skipped. Ranges are aligned to blocks of file system, the first and
+     * last block of a range may be written partially.
+     *
+     * @return <start, end> of ranges in order, end is exclusive. Whole file
+     *  is one range if file system doesn't report holes.
+     */
+    virtual std::vector<std::pair<size_t, size_t>> get_data_ranges() const;
+
+    // Block size of file system, granularity of get_data_ranges().
+    virtual size_t get_block_size() const;
+
+    /**
+     * Gets file descriptor of opened file.
+     *
+     * @return File descriptor or -1 if file is not open.
+     */
+    virtual int get_descriptor() const noexcept;
+
   private:
+    void close();
+
     std::string path;
-    std::fstream file_stream;
+    int file_descriptor;
 };
 
 #endif
@@ -0,0 +1,110 @@
+#ifndef _FILE_WRITER_H
+#define _FILE_WRITER_H
+
+#include <mutex>
+#include <vector>
+#include <condition_variable>
+
+#include "units.h"
+#include "thread.h"
+#include "buffer.h"
+#include "file_io.h"
+
+// Write-behind stage, writes received data to file in its own thread so
+// receiving from network and writing to disk overlap.
+class FileWriter : public Thread
+{
+  public:
+    // <part index, written bytes>
+    using WrittenPart = std::pair<size_t, size_t>;
+
+    /**
+     * C-tor.
+     *
+     * @param file_io Output file, should outlive the writer.
+     * @param memory_budget Maximum bytes waiting to be written.
+     * @throws std::runtime_error if notification descriptor can't be created.
+     */
+    FileWriter(FileIO* file_io, size_t memory_budget = kDefaultMemoryBudget);
+
+    ~FileWriter();
+
+    /**
+     * Queues data to be written at position.
+     * Data is appended to the last queued write of the same part if it is
+     * adjacent to it.
+     *
+     * @param index Index of part which data belongs to.
+     */
+    void enqueue(size_t index, const char* data, size_t length,
+                 size_t position);
+
+    // Blocks while queued bytes exceed the memory budget.
+    void wait_for_budget();
+
+    /**
+     * Gets parts written since last call.
+     *
+     * @param written_parts Filled with written ranges of parts.
+     */
+    void collect_written(std::vector<WrittenPart>& written_parts);
+
+    /**
+     * Gets a descriptor which becomes readable whenever some queued data is
+     * written, collect_written() resets it.
+     */
+    int get_notify_descriptor() const noexcept;
+
+    // Number of queued writes.
+    size_t get_queue_depth() const;
+
+    // Number of bytes waiting to be written.
+    size_t get_pending_bytes() const;
+
+    /**
+     * True if a write has failed. Data of failed writes and later writes of
+     * their parts is not reported by collect_written(), so reported bytes of
+     * a part are always contiguous.
+     */
+    bool has_failed() const;
+
+    // Writes all queued data and stops the thread.
+    void stop();
+
+    constexpr static size_t kDefaultMemoryBudget = 64_MB;
+    constexpr static size_t kMaxWriteSize = 1_MB;
+    // Written buffers kept for next writes, at least this many.
+    constexpr static size_t kMinSpareBuffers = 16;
+
+  private:
+    struct WriteRequest {
+      size_t index;
+      size_t position;
+      Buffer data;
+      bool failed = false;
+    };
+
+    void run() override;
+    // Enough buffers to hold the whole memory budget.
+    size_t get_max_spare_buffers() const noexcept;
+
+    FileIO* file_io;
+    const size_t memory_budget;
+    int notify_descriptor;
+    mutable std::mutex queue_mutex;
+    // Notified when new data is queued or on stop.
+    std::condition_variable queue_cv;
+    // Notified when queued data is written.
+    std::condition_variable budget_cv;
+    std::vector<WriteRequest> requests;
+    // Buffers of written requests, reused by enqueue().
+    std::vector<Buffer> spare_buffers;
+    std::vector<WrittenPart> written_parts;
+    // Parts which have a failed write.
+    std::vector<size_t> failed_parts;
+    size_t pending_bytes;
+    bool keep_running;
+    bool failed;
+};
+
+#endif
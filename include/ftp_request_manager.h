@@ -2,6 +2,7 @@
 #define _FTP_REQUEST_MANAGER_H
 
 #include <mutex>
+#include <future>
 #include <memory>
 #include <atomic>
 #include <vector>
@@ -15,7 +16,12 @@ class FtpRequestManager: public RequestManager
     using RequestManager::RequestManager;
 
   private:
+    constexpr static size_t kMaxConcurrentLogins = 8;
+
+    // Logins run on workers, so data channels are established concurrently.
     virtual void send_requests() override;
+    // Logs in, opens data channel and sends request, blocking.
+    bool start_transfer(const Request& request);
     // return <ip>:<port>
     std::string get_data_channel_addr(SocketOps* sock_ops);
     std::pair<std::string, uint16_t> get_ip_port_pair(const std::string& buffer);
@@ -25,6 +31,8 @@ class FtpRequestManager: public RequestManager
     bool send_ftp_requst(const Request& request, SocketOps* sock_ops);
     std::pair<bool, std::string> send_ftp_command(const Buffer& command,
                                                   SocketOps* sock_ops);
+
+    std::vector<std::future<void>> logins;
 };
 
 #endif
@@ -14,8 +14,13 @@ class HttpRequestManager: public RequestManager
   public:
     using RequestManager::RequestManager;
 
+    void release_sock_ops(std::unique_ptr<SocketOps> sock_ops) override;
+
   private:
     virtual void send_requests() override;
+    // Sends request and hands socket to downloader.
+    bool on_connected(const Request& request,
+                      std::unique_ptr<SocketOps> sock_ops) override;
     Buffer generate_request_str(const Request& request);
 };
 
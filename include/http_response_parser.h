@@ -0,0 +1,110 @@
+#ifndef _HTTP_RESPONSE_PARSER_H
+#define _HTTP_RESPONSE_PARSER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+#include "units.h"
+
+/**
+ * Incremental HTTP/1.1 response header parser. Received data is fed as it
+ * arrives, state is kept between calls so header may be split at any byte.
+ * Fields used by downloader are parsed into fixed storage, nothing is
+ * allocated.
+ */
+class HttpResponseParser
+{
+  public:
+    enum class State {
+      STATUS_LINE,
+      HEADERS,
+      COMPLETE,
+      ERROR
+    };
+
+    // Bytes range of a Content-Range header, end is inclusive. Fields are
+    // kUnknownLength when server sends '*' in their place.
+    struct ContentRange {
+      size_t start = 0;
+      size_t end = 0;
+      size_t total = 0;
+    };
+
+    constexpr static size_t kUnknownLength = SIZE_MAX;
+    // Longer header lines are rejected.
+    constexpr static size_t kMaxLineLength = 8_KB;
+    constexpr static size_t kMaxETagLength = 256;
+    // HTTP-date is 29 characters, obsolete formats are a bit longer.
+    constexpr static size_t kMaxLastModifiedLength = 64;
+
+    HttpResponseParser();
+
+    /**
+     * Parses next received bytes of response.
+     *
+     * @return Number of bytes that belong to header, the rest of data is body.
+     * Equal to length while header is not complete.
+     */
+    size_t parse(const char* data, size_t length);
+
+    // Prepares parser for next response.
+    void reset();
+
+    State get_state() const noexcept;
+    bool is_complete() const noexcept;
+    bool has_error() const noexcept;
+    int get_status_code() const noexcept;
+    // kUnknownLength if Content-Length is not sent.
+    size_t get_content_length() const noexcept;
+    bool has_content_range() const noexcept;
+    const ContentRange& get_content_range() const noexcept;
+    // True if server sends "Accept-Ranges: bytes".
+    bool accepts_ranges() const noexcept;
+    bool is_chunked() const noexcept;
+    // False if server closes connection after response.
+    bool is_persistent() const noexcept;
+    // Empty if not sent.
+    std::string_view get_etag() const noexcept;
+    std::string_view get_last_modified() const noexcept;
+    std::string_view get_location() const noexcept;
+
+    /**
+     * Finds "\r\n\r\n" using the widest vector instructions supported by
+     * CPU.
+     *
+     * @return Position of terminator, std::string_view::npos if not found.
+     */
+    static size_t find_header_terminator(const char* data, size_t length);
+
+    // Portable implementation of find_header_terminator().
+    static size_t find_header_terminator_scalar(const char* data,
+                                                size_t length);
+
+  private:
+    // @param line Without line terminator.
+    void parse_line(std::string_view line);
+    void parse_status_line(std::string_view line);
+    void parse_field(std::string_view name, std::string_view value);
+    bool parse_content_range(std::string_view value);
+
+    State state;
+    int status_code;
+    size_t content_length;
+    ContentRange content_range;
+    bool content_range_received;
+    bool ranges_accepted;
+    bool chunked;
+    bool persistent;
+    size_t etag_length;
+    size_t last_modified_length;
+    size_t location_length;
+    // Beginning of a line split between received blocks.
+    size_t partial_line_length;
+    char partial_line[kMaxLineLength];
+    char etag[kMaxETagLength];
+    char last_modified[kMaxLastModifiedLength];
+    char location[kMaxLineLength];
+};
+
+#endif
@@ -12,13 +12,17 @@ class HttpTransceiver : public Transceiver
     virtual bool receive(Buffer& buffer, SocketOps* sock_ops) override;
     virtual bool send(const Buffer& buffer, Connection& connection) override;
     virtual bool send(const Buffer& buffer, SocketOps* sock_ops) override;
-
-  protected:
-    static constexpr char kHeaderTerminator[] = "\r\n\r\n";
- 
-    ssize_t get_header_terminator_pos(const char* buffer, size_t len) const;
+    virtual size_t skip_header(const Buffer& buffer,
+                               Connection& connection) override;
+    virtual size_t decode_body(char* data, size_t length,
+                               Connection& connection) override;
+    virtual void on_connection_closed(Connection& connection) override;
 
   private:
+    // Return true if response body starts at current position of chunk.
+    static bool matches_chunk(const HttpResponseParser& parser,
+                              const Chunk& chunk);
+
     PlainTransciever plain_transceiver;
 };
 
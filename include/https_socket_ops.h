@@ -4,6 +4,8 @@
 #include <openssl/ssl.h>
 #include <unistd.h>
 
+#include <chrono>
+
 #include "socket_ops.h"
 
 // Socket operations for secure connection.
@@ -12,28 +14,69 @@ class HttpsSocketOps : public SocketOps
   public:
     HttpsSocketOps(const std::string& ip, uint16_t port,
                    const std::string& host);
+    ~HttpsSocketOps() override;
+
+    /**
+     *  Starts connecting and TLS handshake without blocking, last TLS
+     *  session of host is resumed if possible.
+     *  Data of set_early_data() is written before handshake is finished if
+     *  early data is enabled and possible.
+     *
+     *  @see SocketOps::start_connect()
+     */
+    ConnectStatus start_connect() override;
+
+    /**
+     *  @see SocketOps::continue_connect()
+     */
+    ConnectStatus continue_connect() override;
 
     /**
-     *  @see SocketOps::connect()
+     *  @see SocketOps::connect_wants_write()
      */
-    bool connect() override;
+    bool connect_wants_write() const override;
 
     /**
      *  @see SocketOps::disconnect()
      */
     bool disconnect() override;
 
+    /**
+     *  Keeps a copy of data to send as TLS 1.3 early data.
+     *
+     *  @see SocketOps::set_early_data()
+     */
+    void set_early_data(const char* buffer, size_t length) override;
+
+    /**
+     *  Result of early data, valid once handshake is finished. Later calls
+     *  return false.
+     *
+     *  @return True if server accepted early data, otherwise it should be
+     *    sent normally.
+     */
+    bool take_early_data_accepted();
+
     BIO* get_bio() const;
     SSL* get_ssl() const;
 
   private:
-    SSL* retrieve_ssl(BIO* bio);
+    // Verifies certificate and updates TLS statistics.
+    void on_handshake_done();
+
+    // Return status of connecting from result of a failed handshake step.
+    ConnectStatus get_handshake_status(int result);
 
     BIO* bio;
     SSL* ssl;
-    SSL_CTX* ctx{nullptr};
-    X509 *cert{nullptr};
     std::string host;
+    bool tcp_connected;
+    bool handshake_wants_write;
+    // Written before handshake is finished, cleared once it's written.
+    std::string early_data;
+    bool early_data_written;
+    bool early_data_accepted;
+    std::chrono::steady_clock::time_point connect_time_point;
 };
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef _INTERVAL_SET_H
+#define _INTERVAL_SET_H
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Set of disjoint half-open ranges [start, end). Overlapping and adjacent
+ * ranges are coalesced on insertion, so the set holds one range per
+ * contiguous run whatever order ranges are added in.
+ */
+class IntervalSet
+{
+  public:
+    IntervalSet();
+
+    /**
+     * Adds a range, O(log n) plus number of ranges which are coalesced.
+     * Empty ranges are ignored.
+     */
+    void insert(size_t start, size_t end);
+
+    // True if [start, end) is covered by one range.
+    bool contains(size_t start, size_t end) const;
+
+    /**
+     * Returns ranges between begin and end which are not in the set.
+     *
+     * @return <start, end> ranges in order.
+     */
+    std::vector<std::pair<size_t, size_t>> get_gaps(size_t begin,
+                                                    size_t end) const;
+
+    // Total length of ranges.
+    size_t get_length() const noexcept;
+
+    size_t get_range_count() const noexcept;
+
+    bool empty() const noexcept;
+
+    void clear();
+
+  private:
+    // <start, end>
+    std::map<size_t, size_t> ranges;
+    size_t length;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef _MPSC_QUEUE_H
+#define _MPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+// Contention counters of a queue.
+struct QueueStats {
+  size_t pushes = 0;
+  // Producer retries caused by other producers.
+  size_t push_retries = 0;
+  // Pushes which waited for consumer because queue was full.
+  size_t full_waits = 0;
+};
+
+/**
+ * Bounded lock-free queue for many producer threads and one consumer thread.
+ * Slots are allocated once, values are moved in and out of them.
+ */
+template <typename T>
+class MpscQueue
+{
+  public:
+    // @param capacity Rounded up to a power of two.
+    explicit MpscQueue(size_t capacity)
+      : capacity(round_up_capacity(capacity))
+      , slots(std::make_unique<Slot[]>(this->capacity))
+      , tail(0)
+      , head(0)
+      , pushes(0)
+      , push_retries(0)
+      , full_waits(0)
+    {
+      for (size_t i = 0; i < this->capacity; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // @return False if queue is full, value is left untouched.
+    bool try_push(T& value)
+    {
+      size_t position = tail.load(std::memory_order_relaxed);
+      Slot* slot;
+      for (;;) {
+        slot = &slots[position & (capacity - 1)];
+        const size_t kSequence = slot->sequence.load(std::memory_order_acquire);
+        const intptr_t kDiff = static_cast<intptr_t>(kSequence) -
+                               static_cast<intptr_t>(position);
+        if (kDiff == 0) {
+          if (tail.compare_exchange_weak(position, position + 1,
+                                         std::memory_order_relaxed))
+            break;
+        }
+        else if (kDiff < 0) {
+          return false;
+        }
+        else {
+          position = tail.load(std::memory_order_relaxed);
+        }
+        push_retries.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      slot->value = std::move(value);
+      slot->sequence.store(position + 1, std::memory_order_release);
+      pushes.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    // Pushes value, yields while queue is full.
+    void push(T value)
+    {
+      if (try_push(value))
+        return;
+      full_waits.fetch_add(1, std::memory_order_relaxed);
+      while (!try_push(value))
+        std::this_thread::yield();
+    }
+
+    // Should be called by consumer thread only.
+    // @return False if queue is empty.
+    bool try_pop(T& value)
+    {
+      Slot& slot = slots[head & (capacity - 1)];
+      if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+        return false;
+
+      value = std::move(slot.value);
+      slot.sequence.store(head + capacity, std::memory_order_release);
+      ++head;
+      return true;
+    }
+
+    size_t get_capacity() const noexcept
+    {
+      return capacity;
+    }
+
+    QueueStats get_stats() const
+    {
+      QueueStats stats;
+      stats.pushes = pushes.load(std::memory_order_relaxed);
+      stats.push_retries = push_retries.load(std::memory_order_relaxed);
+      stats.full_waits = full_waits.load(std::memory_order_relaxed);
+      return stats;
+    }
+
+  private:
+    constexpr static size_t kCacheLineSize = 64;
+
+    struct Slot {
+      // Equal to position when slot is free, position + 1 when it's filled.
+      std::atomic<size_t> sequence;
+      T value;
+    };
+
+    static size_t round_up_capacity(size_t capacity)
+    {
+      size_t result = 2;
+      while (result < capacity)
+        result <<= 1;
+      return result;
+    }
+
+    const size_t capacity;
+    std::unique_ptr<Slot[]> slots;
+    // Producers and consumer positions on separate cache lines.
+    alignas(kCacheLineSize) std::atomic<size_t> tail;
+    alignas(kCacheLineSize) size_t head;
+    alignas(kCacheLineSize) std::atomic<size_t> pushes;
+    std::atomic<size_t> push_retries;
+    std::atomic<size_t> full_waits;
+};
+
+#endif
@@ -12,7 +12,7 @@
 class Node : public Thread {
   public:
     Node(const std::string& url, const std::string& optional_path = kCurrDir,
-         uint16_t number_of_parts=1,
+         size_t number_of_parts=1,
          long int timeout=DEFAULT_TIMEOUT_SECONDS);
     virtual void on_get_file_info(size_t node_index, size_t file_size,
                                   const std::string& file_name) {};
@@ -40,7 +40,51 @@ class Node : public Thread {
      *
      * @param parts Number of parts
      */
-    void set_parts(uint16_t parts);
+    void set_parts(size_t parts);
+
+    /**
+     * Set i/o engine of downloader.
+     *
+     * @param io_engine I/O engine, default is IoEngine::EPOLL.
+     */
+    void set_io_engine(IoEngine io_engine);
+
+    /**
+     * Set how often download state is persisted.
+     *
+     * @param checkpoint_policy Checkpoint triggers and durability.
+     */
+    void set_checkpoint_policy(const CheckpointPolicy& checkpoint_policy);
+
+    /**
+     * Set bounds of chunk size adapted to throughput of each connection.
+     * Minimum size is raised to StateManager::kMinChunkSize, so it applies
+     * to initial chunks too.
+     *
+     * @param chunk_size_policy Chunk size bounds and target chunk time.
+     */
+    void set_chunk_size_policy(const ChunkSizePolicy& chunk_size_policy);
+
+    /**
+     * Send requests of resumed TLS 1.3 connections as 0-RTT early data.
+     * Early data can be replayed by network attackers, only GET requests
+     * are sent.
+     *
+     * @param enabled Default is False.
+     */
+    void set_tls_early_data(bool enabled);
+
+    /**
+     * Time from start of download until all parts were receiving, valid
+     * after download is finished.
+     */
+    std::chrono::milliseconds get_ramp_up_time() const;
+
+    /**
+     * Status of download, OperationStatus::FINISHED if whole file is
+     * received. Valid after download is finished.
+     */
+    OperationStatus get_status() const;
 
   protected:
     // callback refresh interval in milliseconds
@@ -52,7 +96,12 @@ class Node : public Thread {
     constexpr static char kCurrDir[] = "./";
     constexpr static time_t DEFAULT_TIMEOUT_SECONDS = 10;
 
+    // Times download is started again if file changes on server.
+    constexpr static size_t kMaxRestarts = 3;
+
     void run();
+    // Downloads file once, sets status.
+    void download();
     void check_download_state();
 
     // pair of output file path and stat file path.
@@ -69,12 +118,18 @@ class Node : public Thread {
     std::string file_path;
     std::string url;
     const std::string optional_path;
-    uint16_t number_of_parts;
+    size_t number_of_parts;
     long int timeout;
 
     std::string proxy_url;
     size_t speed_limit;
     bool resume;
+    IoEngine io_engine;
+    CheckpointPolicy checkpoint_policy;
+    ChunkSizePolicy chunk_size_policy;
+    bool tls_early_data;
+    std::chrono::milliseconds ramp_up_time{0};
+    OperationStatus status = OperationStatus::NOT_STARTED;
 };
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef _REQUEST_MANAGER_H
 #define _REQUEST_MANAGER_H
 
+#include <map>
 #include <mutex>
 #include <memory>
 #include <atomic>
@@ -9,17 +10,24 @@
 
 #include "thread.h"
 #include "buffer.h"
+#include "event_loop.h"
+#include "mpsc_queue.h"
 #include "socket_ops.h"
 #include "transceiver.h"
+#include "wakeup_event.h"
 #include "connection_manager.h"
 
 // index, socket
 using DwlAvailNotifyCB =
-  std::function<void(uint16_t, std::unique_ptr<SocketOps> sock_ops)>;
+  std::function<void(size_t, std::unique_ptr<SocketOps> sock_ops)>;
 
 struct Request
 {
-  Request(int socket, size_t end_pos, size_t start_pos, uint16_t request_index)
+  Request()
+    : Request(0, 0, 0, 0)
+  {
+  }
+  Request(int socket, size_t end_pos, size_t start_pos, size_t request_index)
     : socket(socket)
     , end_pos(end_pos)
     , start_pos(start_pos)
@@ -30,7 +38,8 @@ struct Request
   int socket;
   size_t end_pos;
   size_t start_pos;
-  uint16_t request_index;
+  // Index of part, same as key of its connection in Downloader.
+  size_t request_index;
   bool sent;
 };
 
@@ -41,10 +50,34 @@ class RequestManager : public Thread
                    std::unique_ptr<Transceiver> transceiver);
     void stop();
     void set_proxy(std::string& host, uint32_t port);
-    void add_request(size_t start_pos, size_t length, uint16_t request_index);
+    void add_request(size_t start_pos, size_t length, size_t request_index);
+
+    /**
+     * Sets size of request queue, should be called before adding requests.
+     * add_request() waits while queue is full.
+     *
+     * @param capacity Maximum number of requests waiting to be sent.
+     */
+    void set_queue_capacity(size_t capacity);
+
+    // Contention counters of request queue.
+    QueueStats get_queue_stats() const;
 
     void register_dwl_notify_cb(DwlAvailNotifyCB dwl_notify_cb);
 
+    /**
+     * Takes back a connection whose response is completely received.
+     * Default implementation closes it, protocols which support persistent
+     * connections reuse it for next requests.
+     */
+    virtual void release_sock_ops(std::unique_ptr<SocketOps> sock_ops) {}
+
+    /**
+     * Takes connection of link check, its response is the beginning of
+     * file. sock_ops of result is nullptr if it's not available.
+     */
+    ProbeResponse take_probe_response();
+
   protected:
     std::unique_ptr<ConnectionManager> connection_manager;
     std::unique_ptr<Transceiver> transceiver;
@@ -52,17 +85,56 @@ class RequestManager : public Thread
     std::string proxy_host;
     uint32_t proxy_port;
 
-    std::mutex request_mutex;
+    // Requests taken from request queue, used by run loop only.
     std::vector<Request> requests;
 
     DwlAvailNotifyCB notify_dwl_available;
 
+    /**
+     * Establishes connection of request without blocking, on_connected() is
+     * called when it is ready.
+     * Request is marked as sent, it is queued again if connecting fails.
+     */
+    void connect_async(Request& request, std::unique_ptr<SocketOps> sock_ops);
+
+    /**
+     * Called when connection of request is established.
+     * Default implementation hands socket to downloader.
+     *
+     * @param sock_ops Connected socket in blocking mode.
+     * @return False if request should be retried.
+     */
+    virtual bool on_connected(const Request& request,
+                              std::unique_ptr<SocketOps> sock_ops);
+
+    // Queues request again, can be called from any thread.
+    void retry_request(Request request);
+
+    // Wakes up run loop, e.g. when send_requests() can make progress.
+    void wake_up();
+
   private:
+    constexpr static size_t kDefaultQueueCapacity = 64;
+    // Waiting time in milliseconds while unsent requests are pending.
+    constexpr static int kRetryWaitMs = 10;
+    // Waiting time in milliseconds without pending requests, wake_up()
+    // interrupts it.
+    constexpr static int kIdleWaitMs = 1000;
+
     void run() override;
     virtual void send_requests() = 0;
     void remove_sent_requests();
-    bool request_available();
+    // Moves queued requests to requests.
+    void collect_requests();
+    // Continues connecting sockets which are ready, returns on wake_up().
+    void wait_events(int timeout_ms);
     std::atomic<bool> keep_running;
+    std::unique_ptr<MpscQueue<Request>> request_queue;
+    std::unique_ptr<EventLoop> event_loop;
+    WakeupEvent wakeup_event;
+    std::vector<size_t> ready_keys;
+    // <request index, <request, connecting socket>>
+    std::map<size_t, std::pair<Request, std::unique_ptr<SocketOps>>> connecting;
 };
 
 #endif
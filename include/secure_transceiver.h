@@ -6,7 +6,9 @@
 class SecureTransceiver
 {
   public:
+  // Return 0 if socket is drained, -1 if connection is closed or failed.
   ssize_t receive(SSL* ssl, char* buffer, const size_t len);
+  // Return false if buffer couldn't be sent completely.
   bool send(BIO* bio, const char* buffer, const size_t len);
 };
 
@@ -3,6 +3,13 @@
 
 #include <string>
 
+enum class ConnectStatus {
+  CONNECTED,
+  // Call continue_connect() on readiness of socket.
+  IN_PROGRESS,
+  FAILED
+};
+
 // Socket operations class.
 class SocketOps
 {
@@ -17,10 +24,36 @@ class SocketOps
     SocketOps(const std::string& ip, uint16_t port);
 
     /**
-     * Connects to 'ip' and 'port' specified in c-tor.
+     * Connects to 'ip' and 'port' specified in c-tor, blocks until
+     * connection is ready. Socket is left in blocking mode.
      * @return True if connecting is successful.
      */
-     virtual bool connect();
+    bool connect();
+
+    /**
+     * Starts connecting without blocking, socket is in non-blocking mode
+     * until connection is ready.
+     * @return Status of connection.
+     */
+    virtual ConnectStatus start_connect();
+
+    /**
+     * Continues connecting on readiness of socket.
+     * @return Status of connection.
+     */
+    virtual ConnectStatus continue_connect();
+
+    /**
+     *  Direction of readiness which connecting is waiting for.
+     *  @return True if waiting for socket to be writable.
+     */
+    virtual bool connect_wants_write() const;
+
+    /**
+     *  Sets data which is sent while connecting if protocol allows it,
+     *  should be called before start_connect(). Ignored by default.
+     */
+    virtual void set_early_data(const char* buffer, size_t length);
 
     /**
      *  Disconnects socket from 'ip' and 'port'.
@@ -34,6 +67,18 @@ class SocketOps
      */
     virtual int get_socket_descriptor() const noexcept;
 
+    /**
+     *  Sets or clears O_NONBLOCK flag of the socket descriptor.
+     *  @return True if flag is changed successfully.
+     */
+    bool set_non_blocking(bool non_blocking = true);
+
+    /**
+     *  Checks an idle connection is still open and has no unread data.
+     *  @return True if connection can be used for a new request.
+     */
+    bool is_reusable() const;
+
     void set_http_proxy(const std::string& host, uint16_t port);
 
   protected:
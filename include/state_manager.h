@@ -4,11 +4,16 @@
 #include <map>
 #include <cmath>
 #include <queue>
+#include <limits>
+#include <chrono>
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include <iostream>
 
 #include "units.h"
 #include "file_io.h"
+#include "interval_set.h"
 
 struct Chunk {
   Chunk();
@@ -18,8 +23,35 @@ struct Chunk {
   size_t start;
   size_t current;
   size_t end;
-  bool finished;
-  bool busy;
+  // Changed since last checkpoint.
+  bool dirty;
+  // Position of part record in .stat file.
+  size_t slot;
+};
+
+enum class Durability {
+  // State is written to .stat file, kernel decides when it reaches disk.
+  BEST_EFFORT,
+  // Output file and .stat file are synced on every checkpoint.
+  SYNC
+};
+
+// When received progress is persisted in .stat file, 0 disables a trigger.
+struct CheckpointPolicy {
+  size_t bytes = 4_MB;
+  size_t interval_ms = 1000;
+  bool on_chunk_finish = true;
+  Durability durability = Durability::BEST_EFFORT;
+};
+
+// Bounds of chunk size which is adapted to throughput of each connection.
+// min_size is at least StateManager::kMinChunkSize.
+struct ChunkSizePolicy {
+  size_t min_size = 1_MB;
+  size_t max_size = 64_MB;
+  // Download time which a chunk should take.
+  size_t target_ms = 2000;
+  bool adaptive = true;
 };
 
 class StateManager
@@ -44,44 +76,193 @@ class StateManager
 
     std::pair<size_t, Chunk> get_part();
 
+    /**
+     * Returns next part with given chunk size instead of default one.
+     * Retrieved parts which span to end of file are truncated to chunk size.
+     *
+     * @param chunk_size Maximum size of part.
+     * @return Part <index, chunk>.
+     */
+    std::pair<size_t, Chunk> get_part(size_t chunk_size);
+
+    /**
+     * Splits remaining range of an in-flight part, the original part is
+     * truncated at split_position and the rest becomes a new part.
+     *
+     * @param index Index of part to split.
+     * @param split_position Last position which remains in original part.
+     * @throws std::runtime_error if split position is not inside the
+     *  remaining range of part.
+     * @return New part <index, chunk>.
+     */
+    std::pair<size_t, Chunk> split_part(size_t index, size_t split_position);
+
     void create_new_state(size_t file_size);
 
+    /**
+     * Creates state of a file whose size is not known before it's received.
+     * File is received as one part until finish_stream() is called.
+     */
+    void create_streaming_state();
+
+    // True until size of a streamed file is known.
+    bool is_streaming() const;
+
+    /**
+     * Sets size of a streamed file once its end is received.
+     *
+     * @param file_size Number of bytes received for the single part.
+     */
+    void finish_stream(size_t file_size);
+
+    // Sizes smaller than kMinChunkSize are ignored.
     void set_chunk_size(size_t chunk_size);
 
     size_t get_chunk_size() const;
 
     size_t get_file_size() const;
 
+    // Bytes written to output file, O(1).
     size_t get_total_recvd_bytes() const;
 
+    // Written ranges of output file, coalesced.
+    const IntervalSet& get_completed_ranges() const;
+
+    /**
+     * Sets validator of remote file, a strong ETag or Last-Modified date.
+     * It's stored in .stat file so changes of file are detected before
+     * resuming. Validators longer than kMaxValidatorLength are not stored.
+     */
+    void set_validator(const std::string& validator);
+
+    std::string get_validator() const;
+
+    /**
+     * Checks whether retrieved state belongs to current version of remote
+     * file. Validators are not compared if either of them is unknown.
+     *
+     * @return False if size or validator of remote file is changed.
+     */
+    bool matches_remote_file(size_t file_size,
+                             const std::string& validator) const;
+
     std::queue<std::pair<size_t, Chunk>> get_initial_parts() const;
 
+    /**
+     * Retrieves state from .stat file.
+     * Both binary and former text .stat files are supported, text files are
+     * converted to binary format.
+     *
+     * @throws std::runtime_error if .stat file is not available or its
+     *  version is not supported.
+     */
     void retrieve();
+
+    /**
+     * Rebuilds state from ranges of output file which hold data, used when
+     * .stat file is lost. Edge blocks of ranges may be written partially,
+     * they are received again.
+     *
+     * @param file_size Size of remote file.
+     * @param data_ranges <start, end> ranges in order, end is exclusive.
+     * @param block_size Granularity of data_ranges.
+     * @return False if nothing can be recovered. A range which covers whole
+     *  file is not trusted, file system may not report holes.
+     */
+    bool recover(size_t file_size,
+                 const std::vector<std::pair<size_t, size_t>>& data_ranges,
+                 size_t block_size);
     /**
      *  Updates status of some chunk.
+     *  Received bytes should be written to output file before calling this,
+     *  .stat file is written according to checkpoint policy. Finished parts
+     *  are forgotten, only their range is kept in completed ranges.
      *
      *  @param index Index of updating chunk.
      *  @param recvd_butes Received bytes for chunk.
      */
     void update(size_t index, size_t recvd_butes);
 
+    void set_checkpoint_policy(const CheckpointPolicy& checkpoint_policy);
+
+    /**
+     * Sets output file which is synced before .stat file on checkpoints
+     * with Durability::SYNC.
+     *
+     * @param data_file Output file, nullptr to unset.
+     */
+    void set_data_file(FileIO* data_file);
+
+    /**
+     * Writes changed chunks to .stat file.
+     * Output file is synced first, so .stat file never points beyond
+     * stored data.
+     */
+    void checkpoint();
+
+    // Size of a streamed file, files can't be larger than off_t allows.
+    constexpr static size_t kUnknownFileSize =
+      std::numeric_limits<int64_t>::max();
+
+    // Version of binary .stat file format.
+    constexpr static uint32_t kStateVersion = 3;
+
+    // Room for validator in .stat file header.
+    constexpr static size_t kMaxValidatorLength = 256;
+
+    constexpr static size_t kMinChunkSize = 1_MB;
+
   protected:
     std::unique_ptr<FileIO> state_file;
 
   private:
-    constexpr static size_t kMinChunkSize = 1_MB;
-    void read_raw_data();
+    void read_text_state(const std::string& contents);
+    // Return version of .stat file.
+    uint32_t read_binary_state(const std::string& contents);
+    void add_retrieved_part(size_t index, const Chunk& chunk, size_t slot);
+    // Completed ranges are what is handed out and not left in parts.
+    void rebuild_completed_ranges();
+    // Forgets parts of previous state.
+    void clear_parts();
+    // Exclusive end of part, end of last part is file size.
+    size_t get_part_end(const Chunk& chunk) const;
+    // Exclusive end of range handed out from the file.
+    size_t get_handed_out_end() const;
+    size_t allocate_slot();
+    // Rewrites whole .stat file, records are packed.
     void store();
-    void remove_finished_parts();
+    void store_header();
+    void store_frontier();
+    void store_record(size_t index);
+    void erase_record(size_t slot);
+    void mark_dirty(size_t index);
+    bool checkpoint_due(bool chunk_finished) const;
 
-    // <index, chunk>
+    // Unfinished parts <index, chunk>, bounded by number of connections.
     std::map<size_t, Chunk> parts;
-    std::queue<std::pair<size_t, Chunk>> initial_parts;
-    size_t initial_index;
+    // Indices of retrieved parts which are not handed out yet.
+    std::queue<size_t> initial_parts;
+    IntervalSet completed_ranges;
+    // Index of next new part.
+    size_t next_part_index;
+    // End of the last range handed out from the file.
+    size_t frontier;
     size_t download_file_size;
-    size_t total_recvd_bytes;
     size_t chunk_size;
+    std::string validator;
     bool inited;
+
+    CheckpointPolicy checkpoint_policy;
+    FileIO* data_file;
+    // Parts to be written and slots of finished parts to be erased on next
+    // checkpoint.
+    std::vector<size_t> dirty_parts;
+    std::vector<size_t> erased_slots;
+    // Erased slots are reused, so .stat file doesn't grow with file size.
+    std::vector<size_t> free_slots;
+    size_t slot_count;
+    size_t bytes_since_checkpoint;
+    std::chrono::steady_clock::time_point last_checkpoint;
 };
 
 #endif
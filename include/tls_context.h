@@ -0,0 +1,82 @@
+#ifndef _TLS_CONTEXT_H
+#define _TLS_CONTEXT_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include <openssl/ssl.h>
+
+// Client SSL_CTX shared by all https connections, keeps last TLS session of
+// each host for resumption.
+class TlsContext
+{
+  public:
+    struct Stats {
+      size_t handshakes = 0;
+      size_t resumed_handshakes = 0;
+      size_t early_data_accepted = 0;
+      // Sum of connect and handshake durations.
+      std::chrono::microseconds handshake_time{0};
+    };
+
+    ~TlsContext();
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    /**
+     * Process-wide context.
+     * @throws std::runtime_error if SSL_CTX can't be created.
+     */
+    static TlsContext& get_instance();
+
+    /**
+     * Creates client SSL for host, last session of host is set for
+     * resumption if available.
+     *
+     * @param host Host name used for SNI and certificate verification.
+     * @param port Port of host, sessions are kept per host and port.
+     * @return New SSL object owned by caller.
+     */
+    SSL* new_ssl(const std::string& host, uint16_t port);
+
+    /**
+     * Enables sending first request in TLS 1.3 0-RTT early data on resumed
+     * connections. Early data can be replayed, use it for idempotent
+     * requests only. Disabled by default.
+     */
+    void set_early_data(bool enabled);
+
+    // Return true if request can be sent as early data on ssl.
+    bool early_data_possible(SSL* ssl) const;
+
+    /**
+     * Counts finished handshake of ssl in stats.
+     *
+     * @param handshake_time Time from starting connect until handshake is
+     *   done.
+     */
+    void on_handshake_done(SSL* ssl, std::chrono::microseconds handshake_time);
+
+    Stats get_stats() const;
+
+  private:
+    TlsContext();
+
+    static int on_new_session(SSL* ssl, SSL_SESSION* session);
+
+    SSL_CTX* ctx;
+    std::atomic<bool> early_data;
+    mutable std::mutex sessions_mutex;
+    // <host:port, last session>
+    std::map<std::string, SSL_SESSION*> sessions;
+    std::atomic<size_t> handshakes;
+    std::atomic<size_t> resumed_handshakes;
+    std::atomic<size_t> early_data_accepted;
+    std::atomic<int64_t> handshake_time_us;
+};
+
+#endif
@@ -12,6 +12,37 @@ class Transceiver
   virtual bool receive(Buffer& buffer, SocketOps* sock_ops) = 0;
   virtual bool send(const Buffer& buffer, Connection& socket_ops) = 0;
   virtual bool send(const Buffer& buffer, SocketOps* sock_ops) = 0;
+
+  /**
+   * Parses protocol header of freshly received data, data is not moved.
+   * Sets connection.header_skipped when the header is completely received.
+   *
+   * @return Offset of body in buffer, buffer.length() if block has no body.
+   */
+  virtual size_t skip_header(const Buffer& buffer, Connection& connection)
+  {
+    connection.header_skipped = true;
+    return 0;
+  }
+
+  /**
+   * Removes transfer framing from received body in place. Sets
+   * connection.end_of_body when framing marks end of body, and
+   * connection.status if framing is invalid.
+   *
+   * @return Number of body bytes at the beginning of data.
+   */
+  virtual size_t decode_body(char* data, size_t length, Connection& connection)
+  {
+    return length;
+  }
+
+  /**
+   * Called when server closes connection. Sets connection.end_of_body if
+   * closing the connection marks end of body, otherwise connection.status
+   * if body is incomplete.
+   */
+  virtual void on_connection_closed(Connection& connection) {}
 };
 
 #endif
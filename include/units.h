@@ -18,4 +18,9 @@ constexpr size_t operator""_GB(unsigned long long input)
   return pow(2, 30) * input;
 }
 
+constexpr size_t operator""_TB(unsigned long long input)
+{
+  return pow(2, 40) * input;
+}
+
 #endif
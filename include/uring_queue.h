@@ -0,0 +1,98 @@
+#ifndef _URING_QUEUE_H
+#define _URING_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <linux/io_uring.h>
+
+// Minimal io_uring submission/completion queue pair, built directly on the
+// io_uring system calls.
+class UringQueue
+{
+  public:
+    struct Completion {
+      uint64_t user_data;
+      int32_t result;
+    };
+
+    /**
+     * C-tor.
+     *
+     * @param entries Number of submission queue entries.
+     * @throws std::runtime_error if io_uring is not usable.
+     */
+    UringQueue(unsigned entries = kDefaultEntries);
+
+    ~UringQueue();
+
+    UringQueue(const UringQueue&) = delete;
+    UringQueue& operator=(const UringQueue&) = delete;
+
+    // @return True if kernel supports the features used by this class.
+    static bool available();
+
+    /**
+     * Queues a recv() of socket into buffer.
+     *
+     * @return False if submission queue is full even after submitting.
+     */
+    bool prepare_recv(int fd, char* buffer, size_t length, uint64_t user_data);
+
+    /**
+     * Queues a positioned write of buffer into file.
+     *
+     * @return False if submission queue is full even after submitting.
+     */
+    bool prepare_write(int fd, const char* buffer, size_t length,
+                       size_t offset, uint64_t user_data);
+
+    /**
+     * Queues a one-shot wait for fd to become readable.
+     *
+     * @return False if submission queue is full even after submitting.
+     */
+    bool prepare_poll(int fd, uint64_t user_data);
+
+    /**
+     * Submits queued entries, waits for at least one completion and reaps
+     * all available completions.
+     *
+     * @param completions Filled with reaped completions.
+     * @param timeout_ms Maximum waiting time in milliseconds.
+     * @return Number of reaped completions, -1 on error.
+     */
+    int submit_and_wait(std::vector<Completion>& completions, int timeout_ms);
+
+    constexpr static unsigned kDefaultEntries = 256;
+
+  private:
+    io_uring_sqe* get_sqe();
+    int enter(unsigned min_complete, int timeout_ms);
+    void reap(std::vector<Completion>& completions);
+    void release();
+
+    int ring_fd;
+    io_uring_params params;
+
+    // Submission and completion rings share one mapping.
+    void* rings;
+    size_t rings_size;
+    io_uring_sqe* sqes;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+
+    // Local tail, published to kernel on enter().
+    unsigned sqe_tail;
+    unsigned to_submit;
+};
+
+#endif
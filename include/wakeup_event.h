@@ -0,0 +1,29 @@
+#ifndef _WAKEUP_EVENT_H
+#define _WAKEUP_EVENT_H
+
+// Eventfd based wakeup of a thread waiting in an event loop, can be notified
+// from any thread.
+class WakeupEvent
+{
+  public:
+    /**
+     * @throws std::runtime_error if eventfd can't be created.
+     */
+    WakeupEvent();
+    ~WakeupEvent();
+    WakeupEvent(const WakeupEvent&) = delete;
+    WakeupEvent& operator=(const WakeupEvent&) = delete;
+
+    // Makes descriptor readable until reset() is called.
+    void notify();
+
+    // Return true if notified since last call.
+    bool reset();
+
+    int get_descriptor() const noexcept;
+
+  private:
+    int descriptor;
+};
+
+#endif
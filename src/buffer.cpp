@@ -105,17 +105,26 @@ Buffer& Buffer::operator<<(int input)
 
 void Buffer::set_capacity(size_t capacity)
 {
-  this->buffer_capacity = capacity;
-  buffer = make_unique<char[]>(capacity);
+  allocate(capacity);
   buffer_length = 0;
 }
 
 void Buffer::extend(size_t capacity)
 {
-  buffer_capacity = capacity;
-  unique_ptr<char[]> temp_buffer = make_unique<char[]>(buffer_capacity);
+  // Slab of buffer may already be large enough.
+  if (capacity > buffer_capacity &&
+      capacity <= BufferPool::get_slab_size(buffer_capacity)) {
+    memset(buffer.get() + buffer_capacity, 0, capacity - buffer_capacity);
+    buffer.get_deleter().capacity = capacity;
+    buffer_capacity = capacity;
+    return;
+  }
+
+  unique_ptr<char[], BufferPool::Deleter> temp_buffer(
+      BufferPool::allocate(capacity), BufferPool::Deleter{capacity});
   memcpy(temp_buffer.get(), buffer.get(), buffer_length);
   buffer = move(temp_buffer);
+  buffer_capacity = capacity;
 }
 
 size_t Buffer::capacity() const noexcept
@@ -157,6 +166,7 @@ Buffer& Buffer::seek(size_t position)
 
 void Buffer::allocate(size_t capacity)
 {
-  buffer = make_unique<char[]>(capacity);
+  buffer = unique_ptr<char[], BufferPool::Deleter>(
+      BufferPool::allocate(capacity), BufferPool::Deleter{capacity});
   this->buffer_capacity = capacity;
 }
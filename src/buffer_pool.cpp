@@ -0,0 +1,171 @@
+#include "buffer_pool.h"
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Slab sizes grow in half power of two steps: 4, 6, 8, 12, ... 1024 KB.
+constexpr size_t kSlabClasses = 17;
+
+constexpr size_t get_class_size(size_t slab_class)
+{
+  const size_t kBase = BufferPool::kMinSlabSize << (slab_class / 2);
+  return slab_class % 2 == 0 ? kBase : kBase + kBase / 2;
+}
+
+static_assert(get_class_size(kSlabClasses - 1) == BufferPool::kMaxSlabSize,
+              "Largest slab class should be kMaxSlabSize.");
+
+// Return kSlabClasses if capacity is not pooled.
+size_t get_slab_class(size_t capacity)
+{
+  size_t slab_class = 0;
+  while (slab_class < kSlabClasses && get_class_size(slab_class) < capacity)
+    ++slab_class;
+
+  return slab_class;
+}
+
+// Slabs shared between threads, never destroyed so buffers can be released
+// during static destruction.
+struct Depot {
+  mutex depot_mutex;
+  vector<char*> slabs[kSlabClasses];
+};
+
+Depot& get_depot()
+{
+  static Depot* depot = new Depot;
+  return *depot;
+}
+
+// Trivially destructible, stays usable after FreeListsReleaser is destroyed.
+struct FreeLists {
+  char* slabs[kSlabClasses][BufferPool::kMaxLocalSlabs];
+  size_t counts[kSlabClasses];
+  // Set when thread is exiting, slabs go to depot directly.
+  bool released;
+};
+
+thread_local FreeLists free_lists;
+
+// Moves slabs of exiting thread to depot.
+struct FreeListsReleaser {
+  ~FreeListsReleaser()
+  {
+    Depot& depot = get_depot();
+    lock_guard<mutex> lock(depot.depot_mutex);
+    for (size_t slab_class = 0; slab_class < kSlabClasses; ++slab_class) {
+      size_t& count = free_lists.counts[slab_class];
+      depot.slabs[slab_class].insert(depot.slabs[slab_class].end(),
+                                     free_lists.slabs[slab_class],
+                                     free_lists.slabs[slab_class] + count);
+      count = 0;
+    }
+    free_lists.released = true;
+  }
+};
+
+thread_local FreeListsReleaser free_lists_releaser;
+
+atomic<size_t> heap_allocations(0);
+atomic<size_t> reused_slabs(0);
+
+// Takes up to half of a free list worth of slabs from depot.
+void refill(size_t slab_class)
+{
+  Depot& depot = get_depot();
+  lock_guard<mutex> lock(depot.depot_mutex);
+  vector<char*>& depot_slabs = depot.slabs[slab_class];
+  const size_t kCount = min(depot_slabs.size(), BufferPool::kMaxLocalSlabs / 2);
+  copy(depot_slabs.end() - kCount, depot_slabs.end(),
+       free_lists.slabs[slab_class]);
+  depot_slabs.resize(depot_slabs.size() - kCount);
+  free_lists.counts[slab_class] = kCount;
+}
+
+// Moves half of a full free list to depot.
+void spill(size_t slab_class)
+{
+  constexpr size_t kCount = BufferPool::kMaxLocalSlabs / 2;
+  size_t& count = free_lists.counts[slab_class];
+  Depot& depot = get_depot();
+  lock_guard<mutex> lock(depot.depot_mutex);
+  depot.slabs[slab_class].insert(depot.slabs[slab_class].end(),
+                                 free_lists.slabs[slab_class] + count - kCount,
+                                 free_lists.slabs[slab_class] + count);
+  count -= kCount;
+}
+
+}   // namespace
+
+void BufferPool::Deleter::operator()(char* data) const
+{
+  BufferPool::deallocate(data, capacity);
+}
+
+char* BufferPool::allocate(size_t capacity)
+{
+  const size_t kSlabClass = get_slab_class(capacity);
+  if (kSlabClass == kSlabClasses) {
+    heap_allocations.fetch_add(1, memory_order_relaxed);
+    return new char[capacity]();
+  }
+
+  if (free_lists.counts[kSlabClass] == 0 && !free_lists.released)
+    refill(kSlabClass);
+  if (free_lists.counts[kSlabClass] == 0) {
+    heap_allocations.fetch_add(1, memory_order_relaxed);
+    return new char[get_class_size(kSlabClass)]();
+  }
+
+  reused_slabs.fetch_add(1, memory_order_relaxed);
+  char* data = free_lists.slabs[kSlabClass][--free_lists.counts[kSlabClass]];
+  memset(data, 0, capacity);
+  return data;
+}
+
+void BufferPool::deallocate(char* data, size_t capacity) noexcept
+{
+  if (data == nullptr)
+    return;
+
+  const size_t kSlabClass = get_slab_class(capacity);
+  if (kSlabClass == kSlabClasses) {
+    delete[] data;
+    return;
+  }
+
+  if (free_lists.released) {
+    Depot& depot = get_depot();
+    lock_guard<mutex> lock(depot.depot_mutex);
+    depot.slabs[kSlabClass].push_back(data);
+    return;
+  }
+
+  // Makes sure free list is moved to depot when thread exits.
+  static_cast<void>(&free_lists_releaser);
+  if (free_lists.counts[kSlabClass] == kMaxLocalSlabs)
+    spill(kSlabClass);
+  free_lists.slabs[kSlabClass][free_lists.counts[kSlabClass]++] = data;
+}
+
+size_t BufferPool::get_slab_size(size_t capacity) noexcept
+{
+  const size_t kSlabClass = get_slab_class(capacity);
+  return kSlabClass == kSlabClasses ? 0 : get_class_size(kSlabClass);
+}
+
+BufferPool::Stats BufferPool::get_stats()
+{
+  Stats stats;
+  stats.heap_allocations = heap_allocations.load(memory_order_relaxed);
+  stats.reused_slabs = reused_slabs.load(memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,138 @@
+#include "chunked_decoder.h"
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Return -1 if input is not a hexadecimal digit.
+int get_hex_value(char input)
+{
+  if (input >= '0' && input <= '9')
+    return input - '0';
+  if (input >= 'a' && input <= 'f')
+    return input - 'a' + 10;
+  if (input >= 'A' && input <= 'F')
+    return input - 'A' + 10;
+
+  return -1;
+}
+
+}   // namespace
+
+ChunkedDecoder::ChunkedDecoder()
+{
+  reset();
+}
+
+size_t ChunkedDecoder::decode(char* data, size_t length)
+{
+  size_t decoded_length = 0;
+  size_t position = 0;
+  while (position < length &&
+         state != State::FINISHED && state != State::ERROR) {
+    // Data is moved over framing which precedes it.
+    if (state == State::DATA) {
+      const size_t kLength = min(remaining_bytes, length - position);
+      if (decoded_length != position)
+        memmove(data + decoded_length, data + position, kLength);
+      decoded_length += kLength;
+      position += kLength;
+      remaining_bytes -= kLength;
+      if (remaining_bytes == 0)
+        state = State::DATA_CR;
+      continue;
+    }
+
+    const char kInput = data[position++];
+    switch (state) {
+      case State::SIZE:
+        if (get_hex_value(kInput) >= 0) {
+          if (chunk_size > (SIZE_MAX >> 4)) {
+            state = State::ERROR;
+            break;
+          }
+          chunk_size = (chunk_size << 4) | get_hex_value(kInput);
+          ++size_digits;
+        }
+        else if (size_digits == 0)
+          state = State::ERROR;
+        else if (kInput == ';' || kInput == ' ' || kInput == '\t')
+          state = State::EXTENSION;
+        else if (kInput == '\r')
+          state = State::SIZE_LF;
+        else
+          state = State::ERROR;
+        break;
+
+      case State::EXTENSION:
+        if (kInput == '\r')
+          state = State::SIZE_LF;
+        break;
+
+      case State::SIZE_LF:
+        if (kInput != '\n') {
+          state = State::ERROR;
+          break;
+        }
+        // Last chunk has zero size and is followed by optional trailer.
+        remaining_bytes = chunk_size;
+        chunk_size = 0;
+        size_digits = 0;
+        state = remaining_bytes == 0 ? State::TRAILER_START : State::DATA;
+        break;
+
+      case State::DATA_CR:
+        state = kInput == '\r' ? State::DATA_LF : State::ERROR;
+        break;
+
+      case State::DATA_LF:
+        state = kInput == '\n' ? State::SIZE : State::ERROR;
+        break;
+
+      case State::TRAILER_START:
+        state = kInput == '\r' ? State::TRAILER_LF : State::TRAILER;
+        break;
+
+      case State::TRAILER:
+        if (kInput == '\n')
+          state = State::TRAILER_START;
+        break;
+
+      case State::TRAILER_LF:
+        state = kInput == '\n' ? State::FINISHED : State::ERROR;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return decoded_length;
+}
+
+void ChunkedDecoder::reset()
+{
+  state = State::SIZE;
+  chunk_size = 0;
+  size_digits = 0;
+  remaining_bytes = 0;
+}
+
+ChunkedDecoder::State ChunkedDecoder::get_state() const noexcept
+{
+  return state;
+}
+
+bool ChunkedDecoder::is_finished() const noexcept
+{
+  return state == State::FINISHED;
+}
+
+bool ChunkedDecoder::has_error() const noexcept
+{
+  return state == State::ERROR;
+}
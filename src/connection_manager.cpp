@@ -6,8 +6,8 @@
 #include <cstring>
 #include <iostream>
 
-#include "pattern_finder.h"
 #include "ftp_transceiver.h"
+#include "http_response_parser.h"
 #include "http_transceiver.h"
 #include "https_socket_ops.h"
 #include "https_transceiver.h"
@@ -16,6 +16,8 @@ using namespace std;
 
 ConnectionManager::ConnectionManager(const string& url)
   : url_parser(UrlParser(url))
+  , file_length(0)
+  , ranges_supported(false)
 {
   while (true) {
     try {
@@ -48,6 +50,30 @@ size_t ConnectionManager::get_file_length() const
   return file_length;
 }
 
+bool ConnectionManager::supports_ranges() const
+{
+  return ranges_supported;
+}
+
+string ConnectionManager::get_etag() const
+{
+  return etag;
+}
+
+string ConnectionManager::get_last_modified() const
+{
+  return last_modified;
+}
+
+string ConnectionManager::get_validator() const
+{
+  // Weak entity tags can't be used in If-Range.
+  if (!etag.empty() && etag.compare(0, 2, "W/") != 0)
+    return etag;
+
+  return last_modified;
+}
+
 string ConnectionManager::get_host_name() const
 {
   return url_parser.get_host_name();
@@ -68,10 +94,48 @@ int ConnectionManager::get_one_socket_descriptor()
 
 unique_ptr<SocketOps> ConnectionManager::acquire_sock_ops()
 {
+  unique_ptr<SocketOps> sock_ops = acquire_idle_sock_ops();
+  if (sock_ops != nullptr)
+    return sock_ops;
+
   return get_socket_ops();
 }
 
+unique_ptr<SocketOps> ConnectionManager::acquire_idle_sock_ops()
+{
+  lock_guard<mutex> lock(idle_sock_ops_mutex);
+  while (!idle_sock_ops.empty()) {
+    unique_ptr<SocketOps> sock_ops = move(idle_sock_ops.back());
+    idle_sock_ops.pop_back();
+    // Server may close idle connections at any time.
+    if (sock_ops->is_reusable())
+      return sock_ops;
+  }
+
+  return nullptr;
+}
+
+void ConnectionManager::release_sock_ops(unique_ptr<SocketOps> sock_ops)
+{
+  lock_guard<mutex> lock(idle_sock_ops_mutex);
+  if (idle_sock_ops.size() < kMaxIdleConnections)
+    idle_sock_ops.push_back(move(sock_ops));
+}
+
+ProbeResponse ConnectionManager::take_probe_response()
+{
+  return move(probe_response);
+}
+
 unique_ptr<SocketOps> ConnectionManager::get_socket_ops()
+{
+  unique_ptr<SocketOps> sock_ops = create_sock_ops();
+  sock_ops->connect();
+
+  return sock_ops;
+}
+
+unique_ptr<SocketOps> ConnectionManager::create_sock_ops() const
 {
   unique_ptr<SocketOps> sock_ops;
   Protocol protocol = url_parser.get_protocol();
@@ -85,9 +149,8 @@ unique_ptr<SocketOps> ConnectionManager::get_socket_ops()
                                              get_host_name());
       break;
   }
-  sock_ops->connect();
 
-  return move(sock_ops);
+  return sock_ops;
 }
 
 pair<bool, string> ConnectionManager::check_link()
@@ -100,6 +163,8 @@ pair<bool, string> ConnectionManager::check_link()
     case Protocol::FTP:
       transceiver = make_unique<FtpTransceiver>();
       file_length = get_file_length_ftp(transceiver.get(), socket_ops.get());
+      // Parts are requested with REST command.
+      ranges_supported = true;
       return result;
       break;
     case Protocol::HTTP:
@@ -111,11 +176,13 @@ pair<bool, string> ConnectionManager::check_link()
   }
 
   // Use GET instead of HEAD, because some servers doesn't support HEAD
-  // command.
+  // command. Open ended range reveals whether server supports ranges, body
+  // of response is the beginning of file either way.
   Buffer request(1024);
   request << "GET "
     << url_parser.get_path() << url_parser.get_file_name()
     << " HTTP/1.1\r\n"
+    << "Range: bytes=0-\r\n"
     << "User-Agent: no_name_yet!\r\n"
     << "Accept: */*\r\n"
     << "Accept: */*\r\n"
@@ -130,25 +197,48 @@ pair<bool, string> ConnectionManager::check_link()
     throw runtime_error(string("sending request failed, ") + __FUNCTION__);
   Buffer recvd_header;
 
-  PatternFinder pattern_finder;
-  while (true) {
-   // if (!transceiver->receive(recvd_header.seek(recvd_header.length()),
-   //                           socket_ops)) {
+  // Header may come in several blocks.
+  HttpResponseParser& parser = probe_response.parser;
+  parser.reset();
+  size_t header_length = 0;
+  while (!parser.is_complete()) {
     if (!transceiver->receive(recvd_header, socket_ops.get())) {
       throw runtime_error(string("receiving failed, ") + __FUNCTION__);
     }
-    if (pattern_finder.find_http_header_delimiter(recvd_header) > 0)
-      break;
+    header_length = parser.parse(recvd_header, recvd_header.length());
+    if (parser.has_error())
+      throw runtime_error(string("invalid response header, ") + __FUNCTION__);
   }
 
-  // Check header
-  pair<bool, string> redirection;
   // Check redirection
-  redirection = pattern_finder.find_redirection(recvd_header);
-  if (redirection.first)
+  pair<bool, string> redirection = make_pair(false, "");
+  if (!parser.get_location().empty()) {
+    redirection = make_pair(true, string(parser.get_location()));
     url_parser = UrlParser(redirection.second);
-  else
-    file_length = pattern_finder.find_file_length(recvd_header);
+  }
+  else {
+    // Server that ignores Range answers with whole file.
+    ranges_supported = parser.get_status_code() == 206 &&
+                       parser.has_content_range();
+    size_t length = parser.get_content_length();
+    if (parser.has_content_range())
+      length = parser.get_content_range().total;
+    // 0: unknown file length.
+    file_length = length == HttpResponseParser::kUnknownLength ? 0 : length;
+    etag = string(parser.get_etag());
+    last_modified = string(parser.get_last_modified());
+
+    // E.g. 416 for an empty file, body isn't part of file.
+    if (parser.get_status_code() != 200 && !ranges_supported)
+      return redirection;
+    // Server keeps sending body, it's received by the first part.
+    const size_t kBodyLength = recvd_header.length() - header_length;
+    char* data = recvd_header;
+    memmove(data, data + header_length, kBodyLength);
+    recvd_header.set_length(kBodyLength);
+    probe_response.body = move(recvd_header);
+    probe_response.sock_ops = move(socket_ops);
+  }
 
   return redirection;
 }
@@ -1,11 +1,15 @@
 #include <sys/socket.h>
 
 #include <regex>
+#include <algorithm>
+#include <limits>
 
 #include "node.h"
 #include "buffer.h"
 #include "downloader.h"
+#include "epoll_event_loop.h"
 #include "request_manager.h"
+#include "units.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -13,18 +17,57 @@ using namespace std::chrono;
 const string Downloader::HTTP_HEADER =
     "(HTTP\\/\\d\\.\\d\\s*)(\\d+\\s)([\\w|\\s]+\\n)";
 
+namespace {
+
+// Event loop key of file writer notifications.
+constexpr size_t kFileWriterKey = numeric_limits<size_t>::max();
+
+// Event loop key and io_uring user data of wakeup event.
+constexpr size_t kWakeupKey = kFileWriterKey - 1;
+
+// Number of receive/write buffers per connection for io_uring engine.
+constexpr size_t kUringBuffers = 2;
+
+// Parts with less remaining bytes than this are not split.
+constexpr size_t kMinStealSize = 512_KB;
+
+// Chunk time is at least this many round-trips, so request latency of a
+// chunk stays small relative to its transfer.
+constexpr double kRttFactor = 8;
+
+// Failed responses of a part before download is stopped.
+constexpr size_t kMaxRetries = 3;
+
+enum UringOperation : uint64_t {
+  URING_RECV = 0,
+  URING_WRITE = 1
+};
+
+// <part index> <operation> <buffer slot>
+uint64_t uring_user_data(size_t index, UringOperation operation, size_t slot)
+{
+  return (static_cast<uint64_t>(index) << 2) | (operation << 1) | slot;
+}
+
+}   // namespace
+
 Downloader::Downloader(unique_ptr<RequestManager> request_manager,
                        shared_ptr<StateManager> state_manager,
                        unique_ptr<FileIO> file_io,
                        unique_ptr<Transceiver> transceiver)
-  : timeout({.tv_sec=0, .tv_usec=100'000})
+  : timeout_ms(100)
   , timeout_seconds(5)
   , number_of_parts(1)
+  , ramp_up_time_ms(0)
+  , status(OperationStatus::NOT_STARTED)
   , file_io(move(file_io))
+  , file_writer(make_unique<FileWriter>(this->file_io.get()))
+  , event_loop(make_unique<EpollEventLoop>())
+  , io_engine(IoEngine::EPOLL)
   , transceiver(move(transceiver))
-  , wait_first_conn_response(true)
   , state_manager(state_manager)
   , request_manager(move(request_manager))
+  , new_available_parts(make_unique<MpscQueue<NewAvailPart>>(number_of_parts))
 {
   DwlAvailNotifyCB callback = bind(&Downloader::on_dwl_available, this,
                                    placeholders::_1, placeholders::_2);
@@ -46,106 +89,410 @@ void Downloader::set_download_parts(queue<pair<size_t, Chunk>> initial_parts)
   this->initial_parts = initial_parts;
 }
 
-void Downloader::set_parts(uint16_t parts)
+void Downloader::set_parts(size_t parts)
 {
   number_of_parts = parts;
+  // Each part has at most one request or socket in flight.
+  request_manager->set_queue_capacity(parts);
+  new_available_parts = make_unique<MpscQueue<NewAvailPart>>(parts);
+}
+
+void Downloader::set_chunk_size_policy(const ChunkSizePolicy& chunk_size_policy)
+{
+  this->chunk_size_policy = chunk_size_policy;
+}
+
+void Downloader::set_io_engine(IoEngine io_engine)
+{
+  if (io_engine == IoEngine::IO_URING) {
+    if (!UringQueue::available()) {
+      cerr << "io_uring is not available, using epoll." << endl;
+      io_engine = IoEngine::EPOLL;
+    }
+    else if (!uring)
+      uring = make_unique<UringQueue>();
+  }
+  this->io_engine = io_engine;
+}
+
+size_t Downloader::get_write_queue_depth() const
+{
+  return file_writer->get_queue_depth();
+}
+
+QueueStats Downloader::get_request_queue_stats() const
+{
+  return request_manager->get_queue_stats();
+}
+
+QueueStats Downloader::get_socket_queue_stats() const
+{
+  return new_available_parts->get_stats();
+}
+
+milliseconds Downloader::get_ramp_up_time() const
+{
+  return milliseconds(ramp_up_time_ms);
+}
+
+OperationStatus Downloader::get_status() const
+{
+  return status;
 }
 
 void Downloader::run()
 {
+  status = OperationStatus::DOWNLOADING;
+  start_time_point = steady_clock::now();
   init_connections();
-  // TODO: implement using conditional variable.
-  while (wait_first_conn_response)
-    this_thread::sleep_for(milliseconds(10));
 
   Buffer recv_buffer;
   rate.last_recv_time_point = steady_clock::now();
-  const size_t kFileSize = state_manager->get_file_size();
 
-  while (state_manager->get_total_recvd_bytes() < kFileSize) {
+  if (io_engine == IoEngine::IO_URING && file_io->get_descriptor() == -1) {
+    cerr << "Output file has no descriptor, using epoll." << endl;
+    io_engine = IoEngine::EPOLL;
+  }
+  file_writer->start();
+  event_loop->add(file_writer->get_notify_descriptor(), kFileWriterKey);
+  if (io_engine == IoEngine::IO_URING)
+    uring->prepare_poll(wakeup_event.get_descriptor(), kWakeupKey);
+  else
+    event_loop->add(wakeup_event.get_descriptor(), kWakeupKey);
+  state_manager->set_data_file(file_io.get());
+
+  // File size of a streaming download is set when its end is received.
+  while (status == OperationStatus::DOWNLOADING &&
+         state_manager->get_total_recvd_bytes() < state_manager->get_file_size()) {
     check_new_sock_ops();
-    int max_fd = set_descriptors();
 
-    int sel_retval = select(max_fd + 1, &readfds, nullptr, nullptr, &timeout);
-    if (sel_retval == -1)
-      cerr << "Select error occurred." << endl;
-    else if (sel_retval == 0)
-      continue;
-    else if (sel_retval > 0) {
-      timeout = {.tv_sec=timeout_seconds, .tv_usec=100'000};
-      for (auto& [index, connection] : connections) {
-        if (connection.socket_ops.get() == nullptr)
-          continue;
-        size_t recvd_bytes = 0;
-        receive_from_connection(index, recv_buffer);
-        recvd_bytes = recv_buffer.length();
-        if (recvd_bytes) {
-          // Write data
-          size_t pos = connection.chunk.current;
-          file_io->write(recv_buffer, pos);
-
-          update_connection_stat(recvd_bytes, index);
-          rate.total_recv_bytes += recvd_bytes;
-
-          rate_process(rate, recvd_bytes);
-          callback(rate.speed);
-        }
-      }   // End of for loop
+    bool active = false;
+    if (io_engine == IoEngine::IO_URING)
+      active = wait_uring_completions();
+    else
+      active = wait_ready_connections(recv_buffer);
+
+    if (active) {
+      timeout_ms = timeout_seconds * 1000 + 100;
       survey_connections();
-    }   // End of else if
-    else {    // Timeout
-      // TODO: handle this
-    }   // End of else for timeout
+    }
     // Check each connection for timeout
 //    vector<int> timeout_indices = check_timeout();
 //    if (timeout_indices.size() > 0)
 // TODO:     retry(timeout_indices);
 //    callback(rate.speed);
   }   // End of while loop
+  if (status == OperationStatus::DOWNLOADING)
+    status = OperationStatus::FINISHED;
+  else if (io_engine == IoEngine::IO_URING)
+    wait_uring_operations();
   request_manager->stop();
   request_manager->join();
+  file_writer->stop();
+  file_writer->join();
+  update_written_parts();
+  state_manager->checkpoint();
+  state_manager->set_data_file(nullptr);
 }   // End of downloader thread run()
 
-int Downloader::set_descriptors()
+bool Downloader::wait_ready_connections(Buffer& buffer)
 {
-  int max_fd = 0;
-  FD_ZERO(&readfds);
-  for (auto& [index, connection] : connections) {
-    if (connection.socket_ops.get() == nullptr)
+  int ready = event_loop->wait(ready_parts, timeout_ms);
+  if (ready == -1)
+    cerr << "Event loop error occurred." << endl;
+
+  for (size_t index : ready_parts) {
+    if (index == kWakeupKey)
+      wakeup_event.reset();
+    else if (index != kFileWriterKey)
+      receive_from_connection(index, buffer);
+  }
+  update_written_parts();
+
+  return ready > 0;
+}
+
+void Downloader::receive_from_connection(size_t index, Buffer& buffer)
+{
+  auto connection_it = connections.find(index);
+  if (connection_it == connections.end())
+    return;
+  Connection& connection = connection_it->second;
+
+  // Edge-triggered readiness, read until socket would block.
+  while (connection.socket_ops.get() != nullptr &&
+         !chunk_finished(connection.chunk) && !connection_failed(connection)) {
+    buffer.clear();
+    if (!transceiver->receive(buffer, connection)) {
+      if (!connection.end_of_body)
+        cerr << "Receiving part " << index << " failed." << endl;
+      check_end_of_body(connection);
+      break;
+    }
+    if (buffer.length() == 0)
+      break;
+
+    const char* body = nullptr;
+    const size_t kBodyLength = extract_body(buffer, connection, body);
+    if (kBodyLength == 0) {
+      check_end_of_body(connection);
+      continue;
+    }
+
+    // Stop reading from network while disk is behind.
+    file_writer->wait_for_budget();
+
+    // Write data
+    const size_t kPosition = connection.chunk.current;
+    const size_t recvd_bytes = update_connection_stat(kBodyLength, index);
+    file_writer->enqueue(index, body, recvd_bytes, kPosition);
+    check_end_of_body(connection);
+
+    rate.total_recv_bytes += recvd_bytes;
+
+    rate_process(rate, recvd_bytes);
+    callback(rate.speed);
+  }
+}
+
+bool Downloader::wait_uring_completions()
+{
+  int reaped = uring->submit_and_wait(completions, timeout_ms);
+  if (reaped == -1)
+    cerr << "io_uring error occurred." << endl;
+
+  for (const UringQueue::Completion& completion : completions) {
+    if (completion.user_data == kWakeupKey) {
+      wakeup_event.reset();
+      uring->prepare_poll(wakeup_event.get_descriptor(), kWakeupKey);
       continue;
-    int socket_desc = connection.socket_ops->get_socket_descriptor();
-    FD_SET(socket_desc, &readfds);
-    max_fd = (max_fd < socket_desc) ? socket_desc : max_fd;
+    }
+    const size_t kIndex = completion.user_data >> 2;
+    const size_t kSlot = completion.user_data & 1;
+    if (((completion.user_data >> 1) & 1) == URING_RECV)
+      on_uring_recv(kIndex, kSlot, completion.result);
+    else
+      on_uring_write(kIndex, kSlot, completion.result);
+  }
+
+  return reaped > 0;
+}
+
+void Downloader::submit_uring_recv(size_t index)
+{
+  auto connection_it = connections.find(index);
+  if (connection_it == connections.end())
+    return;
+  Connection& connection = connection_it->second;
+  if (connection.recv_in_flight || chunk_finished(connection.chunk) ||
+      connection_failed(connection) || status != OperationStatus::DOWNLOADING)
+    return;
+
+  for (size_t slot = 0; slot < kUringBuffers; ++slot) {
+    const uint32_t kSlotMask = 1u << slot;
+    if (connection.io_buffers_in_use & kSlotMask)
+      continue;
+
+    Buffer& buffer = connection.io_buffers[slot];
+    buffer.clear();
+    const int kSockDesc = connection.socket_ops->get_socket_descriptor();
+    if (!uring->prepare_recv(kSockDesc, buffer, buffer.total_capacity(),
+                             uring_user_data(index, URING_RECV, slot))) {
+      cerr << "io_uring submission queue is full." << endl;
+      return;
+    }
+    connection.io_buffers_in_use |= kSlotMask;
+    connection.recv_in_flight = true;
+    return;
+  }
+  // All buffers are being written, receiving resumes on write completion.
+}
+
+void Downloader::on_uring_recv(size_t index, size_t slot, int32_t result)
+{
+  // Stale completion, connection is removed already.
+  auto connection_it = connections.find(index);
+  if (connection_it == connections.end())
+    return;
+  Connection& connection = connection_it->second;
+  Buffer& buffer = connection.io_buffers[slot];
+  const uint32_t kSlotMask = 1u << slot;
+  connection.recv_in_flight = false;
+
+  // Download is stopped, e.g. a write failed, received data is dropped so
+  // nothing is written after a hole.
+  if (status != OperationStatus::DOWNLOADING) {
+    connection.io_buffers_in_use &= ~kSlotMask;
+    return;
+  }
+
+  // Connection is closed or failed.
+  if (result <= 0) {
+    if (result < 0) {
+      cerr << "Receiving part " << index << " failed." << endl;
+      if (!connection.end_of_body)
+        connection.status = OperationStatus::SOCKET_RECV_ERROR;
+    }
+    else {
+      transceiver->on_connection_closed(connection);
+    }
+    check_end_of_body(connection);
+    connection.io_buffers_in_use &= ~kSlotMask;
+    return;
+  }
+
+  buffer.set_length(result);
+  const char* body = nullptr;
+  const size_t kBodyLength = extract_body(buffer, connection, body);
+  if (kBodyLength == 0) {
+    check_end_of_body(connection);
+    connection.io_buffers_in_use &= ~kSlotMask;
+    submit_uring_recv(index);
+    return;
   }
 
-  return max_fd;
+  const size_t kPosition = connection.chunk.current;
+  const size_t recvd_bytes = update_connection_stat(kBodyLength, index);
+  check_end_of_body(connection);
+  connection.io_writes[slot] = {body, recvd_bytes, kPosition};
+  submit_uring_write(connection, index, slot);
+
+  rate.total_recv_bytes += recvd_bytes;
+  rate_process(rate, recvd_bytes);
+  callback(rate.speed);
+
+  submit_uring_recv(index);
+}
+
+void Downloader::submit_uring_write(Connection& connection, size_t index,
+                                    size_t slot)
+{
+  // Parts are updated from their current position, so a write can't
+  // complete before an earlier one.
+  if (connection.write_in_flight) {
+    connection.write_queued = true;
+    connection.queued_write_slot = slot;
+    return;
+  }
+
+  const UringWrite& write = connection.io_writes[slot];
+  if (uring->prepare_write(file_io->get_descriptor(), write.data, write.length,
+                           write.position, uring_user_data(index, URING_WRITE, slot))) {
+    connection.write_in_flight = true;
+    return;
+  }
+  // Submission queue is full, write synchronously.
+  if (file_io->write(write.data, write.length, write.position))
+    state_manager->update(index, write.length);
+  else
+    on_write_failed();
+  connection.io_buffers_in_use &= ~(1u << slot);
 }
 
-void Downloader::receive_from_connection(size_t _index, Buffer& buffer)
+void Downloader::on_uring_write(size_t index, size_t slot, int32_t result)
 {
-  buffer.clear();
-  Connection& connection = connections[_index];
+  // Stale completion, connection is removed already.
+  auto connection_it = connections.find(index);
+  if (connection_it == connections.end())
+    return;
+  Connection& connection = connection_it->second;
+  const UringWrite& write = connection.io_writes[slot];
+  connection.io_buffers_in_use &= ~(1u << slot);
+  connection.write_in_flight = false;
+  if (result < 0 || static_cast<size_t>(result) != write.length) {
+    cerr << "Writing part " << index << " failed." << endl;
+    on_write_failed();
+    // Following range of part is not written either.
+    if (connection.write_queued) {
+      connection.write_queued = false;
+      connection.io_buffers_in_use &= ~(1u << connection.queued_write_slot);
+    }
+    return;
+  }
+  state_manager->update(index, write.length);
 
-  int sock_desc = connection.socket_ops->get_socket_descriptor();
-  if (FD_ISSET(sock_desc, &readfds)) {
-    transceiver->receive(buffer, connection);
+  if (connection.write_queued) {
+    connection.write_queued = false;
+    submit_uring_write(connection, index, connection.queued_write_slot);
+  }
+  submit_uring_recv(index);
+}
+
+void Downloader::wait_uring_operations()
+{
+  for (auto& [index, connection] : connections)
+    if (connection.recv_in_flight)
+      shutdown(connection.socket_ops->get_socket_descriptor(), SHUT_RDWR);
+
+  auto in_flight = [this]() {
+    for (const auto& [index, connection] : connections)
+      if (connection.io_buffers_in_use != 0)
+        return true;
+    return false;
+  };
+  while (in_flight()) {
+    if (uring->submit_and_wait(completions, timeout_ms) == -1)
+      break;
+    for (const UringQueue::Completion& completion : completions) {
+      if (completion.user_data == kWakeupKey)
+        continue;
+      const size_t kIndex = completion.user_data >> 2;
+      const size_t kSlot = completion.user_data & 1;
+      // Received data is dropped, download is stopped.
+      if (((completion.user_data >> 1) & 1) == URING_RECV)
+        on_uring_recv(kIndex, kSlot, completion.result);
+      else
+        on_uring_write(kIndex, kSlot, completion.result);
+    }
   }
 }
 
 void Downloader::init_connections()
 {
-  for (uint16_t i = 0; i < number_of_parts; ++i) {
-    if (state_manager->part_available())
-      init_connection();
+  // Response of link check is already streaming the file from its start.
+  ProbeResponse probe_response = request_manager->take_probe_response();
+  for (size_t i = 0; i < number_of_parts; ++i) {
+    if (!state_manager->part_available())
+      break;
+
+    pair<size_t, Chunk> part = state_manager->get_part();
+    if (probe_response.sock_ops != nullptr && part.second.current == 0)
+      init_probe_connection(part, probe_response);
     else
-      {/*part not available.*/}
+      init_connection(part);
   }
   request_manager->start();
 }
 
 void Downloader::init_connection()
 {
-  pair<size_t, Chunk> part = state_manager->get_part();
+  init_connection(state_manager->get_part());
+}
+
+size_t Downloader::adapt_chunk_size(const Connection& connection) const
+{
+  if (!chunk_size_policy.adaptive || number_of_parts == 1 ||
+      connection.recvd_bytes == 0)
+    return 0;
+
+  const double kTransferTime = duration<double>(
+      connection.last_recv_time_point - connection.first_recv_time_point).count();
+  if (kTransferTime <= 0)  // Whole chunk arrived at once.
+    return chunk_size_policy.max_size;
+
+  const double kRoundTripTime = duration<double>(
+      connection.first_recv_time_point - connection.request_time_point).count();
+  const double kThroughput = connection.recvd_bytes / kTransferTime;
+  const double kTargetTime = max(chunk_size_policy.target_ms / 1000.0,
+                                 kRttFactor * kRoundTripTime);
+  size_t chunk_size = kThroughput * kTargetTime;
+
+  return min(max(chunk_size, chunk_size_policy.min_size),
+             chunk_size_policy.max_size);
+}
+
+void Downloader::init_connection(const pair<size_t, Chunk>& part)
+{
   const size_t start = part.second.current;
 
   const size_t kConnectionIndex = part.first;
@@ -155,6 +502,100 @@ void Downloader::init_connection()
   request_manager->add_request(start, part.second.end, kConnectionIndex);
 }
 
+void Downloader::init_probe_connection(const pair<size_t, Chunk>& part,
+                                       ProbeResponse& probe_response)
+{
+  const size_t kIndex = part.first;
+  connections[kIndex] = Connection();
+  Connection& connection = connections[kIndex];
+  connection.chunk.end = part.second.end;
+  connection.chunk.current = part.second.current;
+  connection.response_parser = probe_response.parser;
+  // Open ended range of link check runs past the part, its rest is unread.
+  const HttpResponseParser& parser = connection.response_parser;
+  if (!parser.has_content_range() ||
+      parser.get_content_range().end > part.second.end)
+    connection.keep_alive = false;
+
+  // Header is parsed already, skip_header() only applies its fields.
+  const char* body = nullptr;
+  const size_t kBodyLength = extract_body(probe_response.body, connection, body);
+  if (kBodyLength > 0) {
+    const size_t kPosition = connection.chunk.current;
+    const size_t recvd_bytes = update_connection_stat(kBodyLength, kIndex);
+    // Written synchronously, file writer is not running yet.
+    if (file_io->write(body, recvd_bytes, kPosition))
+      state_manager->update(kIndex, recvd_bytes);
+    else
+      on_write_failed();
+    rate.total_recv_bytes += recvd_bytes;
+  }
+  check_end_of_body(connection);
+
+  on_dwl_available(kIndex, move(probe_response.sock_ops));
+}
+
+bool Downloader::steal_part()
+{
+  // The connection with largest remaining range is usually the slowest one.
+  size_t victim_index = 0;
+  size_t largest_remaining = 0;
+  for (auto& [index, connection] : connections) {
+    const Chunk& chunk = connection.chunk;
+    if (chunk.current < chunk.end && chunk.end - chunk.current > largest_remaining) {
+      largest_remaining = chunk.end - chunk.current;
+      victim_index = index;
+    }
+  }
+  if (largest_remaining < kMinStealSize)
+    return false;
+
+  // Victim keeps receiving its old range from server, bytes after the new
+  // end are dropped by update_connection_stat() and the connection is closed
+  // once the truncated chunk is finished.
+  Connection& victim = connections[victim_index];
+  const size_t kSplitPosition = victim.chunk.current + largest_remaining / 2;
+  pair<size_t, Chunk> part = state_manager->split_part(victim_index, kSplitPosition);
+  victim.chunk.end = kSplitPosition;
+  victim.keep_alive = false;
+  init_connection(part);
+
+  return true;
+}
+
+void Downloader::retry_connection(size_t index)
+{
+  Connection& connection = connections[index];
+  if (connection.socket_ops != nullptr && io_engine == IoEngine::EPOLL)
+    event_loop->remove(connection.socket_ops->get_socket_descriptor());
+
+  // If-Range of a later chunk is answered by whole file once it's changed,
+  // received parts belong to former version of file.
+  const HttpResponseParser& parser = connection.response_parser;
+  if (parser.is_complete() && parser.get_status_code() == 200 &&
+      connection.chunk.current != 0 && !state_manager->get_validator().empty()) {
+    status = OperationStatus::FILE_CHANGED;
+    return;
+  }
+  // Stream can't be requested from its middle.
+  if (state_manager->is_streaming() && connection.chunk.current > 0) {
+    cerr << "Receiving stream failed, download is stopped." << endl;
+    status = connection.status;
+    return;
+  }
+
+  const size_t kRetries = connection.retries + 1;
+  if (kRetries > kMaxRetries) {
+    cerr << "Part " << index << " failed " << kMaxRetries
+         << " times, download is stopped." << endl;
+    status = connection.status;
+    return;
+  }
+  // Socket of failed response is closed by replacing its connection.
+  init_connection({index, connection.chunk});
+  connections[index].retries = kRetries;
+}
+
 //vector<int> Downloader::check_timeout()
 //{
 //  vector<int> result;
@@ -205,48 +646,169 @@ void Downloader::rate_process(RateParams& rate, size_t recvd_bytes)
   }
 }
 
-void Downloader::update_connection_stat(size_t recvd_bytes, size_t index)
+size_t Downloader::extract_body(Buffer& buffer, Connection& connection,
+                                const char*& body)
+{
+  // Body is written from where it's received, header may come without it.
+  size_t body_offset = 0;
+  if (!connection.header_skipped)
+    body_offset = transceiver->skip_header(buffer, connection);
+
+  char* body_start = static_cast<char*>(buffer) + body_offset;
+  body = body_start;
+  return transceiver->decode_body(body_start, buffer.length() - body_offset,
+                                  connection);
+}
+
+void Downloader::check_end_of_body(const Connection& connection)
+{
+  if (connection.end_of_body && state_manager->is_streaming())
+    state_manager->finish_stream(connection.chunk.current);
+}
+
+bool Downloader::chunk_finished(const Chunk& chunk) const
+{
+  // End of chunk is inclusive, except for last one which is file size.
+  return chunk.current > chunk.end ||
+         chunk.current >= state_manager->get_file_size();
+}
+
+bool Downloader::connection_failed(const Connection& connection)
+{
+  return connection.status == OperationStatus::RESPONSE_ERROR ||
+         connection.status == OperationStatus::SOCKET_RECV_ERROR;
+}
+
+size_t Downloader::update_connection_stat(size_t recvd_bytes, size_t index)
 {
-  if (connections[index].chunk.current + recvd_bytes > connections[index].chunk.end)
-    recvd_bytes = connections[index].chunk.end - connections[index].chunk.current + 1;
+  Connection& connection = connections[index];
+  if (connection.chunk.current + recvd_bytes > connection.chunk.end + 1) {
+    recvd_bytes = connection.chunk.end - connection.chunk.current + 1;
+    // Rest of response is dropped, connection can't be reused.
+    connection.keep_alive = false;
+  }
+
+  connection.chunk.current += recvd_bytes;
+  connection.last_recv_time_point = steady_clock::now();
+  const bool kFirstRecv = connection.recvd_bytes == 0 && recvd_bytes > 0;
+  if (kFirstRecv)
+    connection.first_recv_time_point = connection.last_recv_time_point;
+  connection.recvd_bytes += recvd_bytes;
+  if (kFirstRecv)
+    check_ramp_up();
 
-  connections[index].chunk.current += recvd_bytes;
-  connections[index].last_recv_time_point = steady_clock::now();
-  state_manager->update(index, recvd_bytes);
+  return recvd_bytes;
+}
+
+void Downloader::check_ramp_up()
+{
+  if (ramp_up_time_ms > 0)
+    return;
+  if (connections.size() < number_of_parts && state_manager->part_available())
+    return;
+  for (const auto& [index, connection] : connections)
+    if (connection.recvd_bytes == 0)
+      return;
+
+  const auto kRampUpTime = duration_cast<milliseconds>(steady_clock::now() -
+                                                       start_time_point);
+  // Zero means not ramped up.
+  ramp_up_time_ms = max<int64_t>(kRampUpTime.count(), 1);
+}
+
+void Downloader::update_written_parts()
+{
+  file_writer->collect_written(written_parts);
+  for (const auto& [index, written_bytes] : written_parts)
+    state_manager->update(index, written_bytes);
+  if (file_writer->has_failed())
+    on_write_failed();
+}
+
+void Downloader::on_write_failed()
+{
+  if (status != OperationStatus::DOWNLOADING)
+    return;
+  cerr << "Writing to file failed, download is stopped." << endl;
+  status = OperationStatus::ERROR;
 }
 
 void Downloader::survey_connections()
 {
   // Remove finished connections
   vector<size_t> finished_connections;
-  for (auto& [index, connection] : connections)
-    if (connection.chunk.current >= connection.chunk.end)
+  vector<size_t> failed_connections;
+  for (auto& [index, connection] : connections) {
+    if (connection.io_buffers_in_use != 0)
+      continue;
+    if (chunk_finished(connection.chunk))
       finished_connections.push_back(index);
+    else if (connection_failed(connection))
+      failed_connections.push_back(index);
+  }
 
-  for (size_t index : finished_connections)
+  // Chunk sizes measured by finished connections, used by their successors.
+  vector<size_t> chunk_sizes;
+  for (size_t index : finished_connections) {
+    Connection& connection = connections[index];
+    if (connection.socket_ops != nullptr) {
+      if (io_engine == IoEngine::EPOLL)
+        event_loop->remove(connection.socket_ops->get_socket_descriptor());
+      // Reuse connection for next request, once whole response is read.
+      if (connection.keep_alive && connection.header_skipped &&
+          connection.end_of_body &&
+          connection.socket_ops->set_non_blocking(false))
+        request_manager->release_sock_ops(move(connection.socket_ops));
+    }
+    size_t chunk_size = adapt_chunk_size(connection);
+    if (chunk_size > 0)
+      chunk_sizes.push_back(chunk_size);
     connections.erase(index);
+  }
+  for (size_t index : failed_connections)
+    retry_connection(index);
+  if (status != OperationStatus::DOWNLOADING)
+    return;
   // Create new connections
-  while (connections.size() < number_of_parts && state_manager->part_available())
-    init_connection();
+  while (connections.size() < number_of_parts && state_manager->part_available()) {
+    if (chunk_sizes.empty()) {
+      init_connection();
+    }
+    else {
+      init_connection(state_manager->get_part(chunk_sizes.back()));
+      chunk_sizes.pop_back();
+    }
+  }
+  // Give idle connections the tail of in-flight parts
+  while (connections.size() < number_of_parts && steal_part())
+    {}
 }
 
-void Downloader::on_dwl_available(uint16_t index,
+void Downloader::on_dwl_available(size_t index,
                                   unique_ptr<SocketOps> sock_ops)
 {
-  lock_guard<mutex> lock(new_available_parts_mutex);
-  new_available_parts.push({index, move(sock_ops)});
-  if (wait_first_conn_response)
-    wait_first_conn_response = false;
+  new_available_parts->push({index, move(sock_ops)});
+  wakeup_event.notify();
 }
 
 void Downloader::check_new_sock_ops()
 {
-  lock_guard<mutex> lock(new_available_parts_mutex);
-  while (!new_available_parts.empty()) {
-    NewAvailPart& new_available_part = new_available_parts.front();
-    connections[new_available_part.part_index].socket_ops = move(
-        new_available_part.sock_ops);
-    new_available_parts.pop();
+  NewAvailPart new_available_part;
+  while (new_available_parts->try_pop(new_available_part)) {
+    const size_t kPartIndex = new_available_part.part_index;
+    connections[kPartIndex].socket_ops = move(new_available_part.sock_ops);
+
+    if (io_engine == IoEngine::IO_URING) {
+      connections[kPartIndex].io_buffers.resize(kUringBuffers);
+      connections[kPartIndex].io_writes.resize(kUringBuffers);
+      submit_uring_recv(kPartIndex);
+      continue;
+    }
+
+    SocketOps* sock_ops = connections[kPartIndex].socket_ops.get();
+    sock_ops->set_non_blocking();
+    if (!event_loop->add(sock_ops->get_socket_descriptor(), kPartIndex))
+      cerr << "Registering connection " << kPartIndex << " failed." << endl;
   }
 }
 
@@ -0,0 +1,50 @@
+#include "epoll_event_loop.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+
+using namespace std;
+
+EpollEventLoop::EpollEventLoop(size_t max_events)
+  : epoll_fd(epoll_create1(EPOLL_CLOEXEC))
+  , events(max_events)
+{
+  if (epoll_fd == -1)
+    throw runtime_error("EpollEventLoop: creating epoll instance failed.");
+}
+
+EpollEventLoop::~EpollEventLoop()
+{
+  close(epoll_fd);
+}
+
+bool EpollEventLoop::add(int fd, size_t key, bool watch_write)
+{
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  if (watch_write)
+    event.events |= EPOLLOUT;
+  event.data.u64 = key;
+
+  return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool EpollEventLoop::remove(int fd)
+{
+  return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+}
+
+int EpollEventLoop::wait(vector<size_t>& ready_keys, int timeout_ms)
+{
+  ready_keys.clear();
+  int ready = epoll_wait(epoll_fd, events.data(), events.size(), timeout_ms);
+  if (ready == -1 && errno == EINTR)
+    ready = 0;
+
+  for (int i = 0; i < ready; ++i)
+    ready_keys.push_back(events[i].data.u64);
+
+  return ready;
+}
@@ -1,20 +1,23 @@
 #include "file_io.h"
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
+#include <cerrno>
 #include <cstdio>
 #include <iostream>
 #include <exception>
-#include <streambuf>
+#include <stdexcept>
 
 using namespace std;
 
 FileIO::~FileIO()
 {
-  file_stream.close();
+  close();
 }
 
-FileIO::FileIO(string path) : path(path)
+FileIO::FileIO(string path) : path(path), file_descriptor(-1)
 {
 }
 
@@ -23,32 +26,63 @@ void FileIO::open()
   // Open existing file for reading and writing
   if (!check_existence())
     create(0);
-  else
-    file_stream.open(path, fstream::in | fstream::out);
+  else {
+    close();
+    file_descriptor = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (file_descriptor == -1)
+      cerr << "Error occurred during opening " << path << endl;
+  }
 }
 
 void FileIO::create(size_t file_length)
 {
-  // TODO: check error
   // Open new file
-  file_stream.open(path, fstream::in | fstream::out | fstream::trunc);
+  close();
+  file_descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                           0644);
+  if (file_descriptor == -1) {
+    cerr << "Error occurred during creating " << path << endl;
+    return;
+  }
+
+  if (file_length == 0)
+    return;
+
+  if (fallocate(file_descriptor, 0, 0, file_length) == 0)
+    return;
 
-  for (size_t i = 1; i <= file_length; i++)
-    file_stream << '\0';
-  file_stream.clear();
-  file_stream.seekg(0);
+  // Preallocation is not supported, extend file sparsely.
+  if (ftruncate(file_descriptor, file_length) != 0)
+    cerr << "Error occurred during resizing " << path << endl;
 }
 
-void FileIO::write(const char* buffer, size_t length, size_t position)
+bool FileIO::write(const char* buffer, size_t length, size_t position)
 {
-  file_stream.seekp(position);
-  file_stream.write(buffer, length);
-  file_stream.flush();
+  size_t written_bytes = 0;
+  while (written_bytes < length) {
+    ssize_t result = pwrite(file_descriptor, buffer + written_bytes,
+                            length - written_bytes, position + written_bytes);
+    if (result == -1 && errno == EINTR)
+      continue;
+    if (result <= 0) {
+      cerr << "Error occurred during writing " << path << endl;
+      return false;
+    }
+    written_bytes += result;
+  }
+
+  return true;
 }
 
-void FileIO::write(const Buffer& buffer, size_t position)
+bool FileIO::write(const Buffer& buffer, size_t position)
 {
-  write(const_cast<Buffer&>(buffer), buffer.length(), position);
+  return write(const_cast<Buffer&>(buffer), buffer.length(), position);
+}
+
+void FileIO::sync()
+{
+  if (file_descriptor != -1 && fdatasync(file_descriptor) != 0)
+    cerr << "Error occurred during syncing " << path << endl;
 }
 
 bool FileIO::check_existence() const
@@ -76,16 +110,78 @@ PathType FileIO::check_path_type()
 
 string FileIO::get_file_contents()
 {
-  if (!file_stream.is_open())
+  if (file_descriptor == -1)
     throw runtime_error("FileIO is not open.");
 
-  file_stream.seekp(0);
-  return string((istreambuf_iterator<char>(file_stream)),
-      istreambuf_iterator<char>());
+  string contents;
+  char read_buffer[Buffer::kDefaultCapacity];
+  while (true) {
+    ssize_t result = pread(file_descriptor, read_buffer, sizeof(read_buffer),
+                           contents.length());
+    if (result == -1 && errno == EINTR)
+      continue;
+    if (result <= 0)
+      break;
+    contents.append(read_buffer, result);
+  }
+
+  return contents;
 }
 
 void FileIO::remove()
 {
-  file_stream.close();
+  close();
   ::remove(path.c_str());
 }
+
+size_t FileIO::get_size() const
+{
+  struct stat status;
+  if (file_descriptor == -1 || fstat(file_descriptor, &status) != 0)
+    return 0;
+
+  return status.st_size;
+}
+
+vector<pair<size_t, size_t>> FileIO::get_data_ranges() const
+{
+  vector<pair<size_t, size_t>> ranges;
+  if (file_descriptor == -1)
+    return ranges;
+
+  off_t position = 0;
+  while (true) {
+    // ENXIO: no data after position.
+    const off_t kDataStart = lseek(file_descriptor, position, SEEK_DATA);
+    if (kDataStart == -1)
+      break;
+    const off_t kDataEnd = lseek(file_descriptor, kDataStart, SEEK_HOLE);
+    if (kDataEnd == -1)
+      break;
+    ranges.emplace_back(kDataStart, kDataEnd);
+    position = kDataEnd;
+  }
+
+  return ranges;
+}
+
+size_t FileIO::get_block_size() const
+{
+  struct stat status;
+  if (file_descriptor == -1 || fstat(file_descriptor, &status) != 0)
+    return 0;
+
+  return status.st_blksize;
+}
+
+int FileIO::get_descriptor() const noexcept
+{
+  return file_descriptor;
+}
+
+void FileIO::close()
+{
+  if (file_descriptor != -1)
+    ::close(file_descriptor);
+  file_descriptor = -1;
+}
@@ -0,0 +1,173 @@
+#include "file_writer.h"
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+FileWriter::FileWriter(FileIO* file_io, size_t memory_budget)
+  : file_io(file_io)
+  , memory_budget(memory_budget)
+  , notify_descriptor(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  , pending_bytes(0)
+  , keep_running(true)
+  , failed(false)
+{
+  if (notify_descriptor == -1)
+    throw runtime_error("FileWriter: creating eventfd failed.");
+  requests.reserve(get_max_spare_buffers());
+  spare_buffers.reserve(get_max_spare_buffers());
+  written_parts.reserve(get_max_spare_buffers());
+}
+
+FileWriter::~FileWriter()
+{
+  close(notify_descriptor);
+}
+
+void FileWriter::enqueue(size_t index, const char* data, size_t length,
+                         size_t position)
+{
+  {
+    lock_guard<mutex> lock(queue_mutex);
+    WriteRequest* tail = nullptr;
+    for (auto it = requests.rbegin(); it != requests.rend(); ++it)
+      if (it->index == index) {
+        tail = &(*it);
+        break;
+      }
+
+    if (tail != nullptr &&
+        tail->position + tail->data.length() == position &&
+        tail->data.length() + length <= kMaxWriteSize) {
+      Buffer& tail_data = tail->data;
+      const size_t kNewLength = tail_data.length() + length;
+      if (tail_data.capacity() < length)
+        tail_data.extend(min(kMaxWriteSize, kNewLength * 2));
+      memcpy(static_cast<char*>(tail_data) + tail_data.length(), data, length);
+      tail_data.set_length(kNewLength);
+    }
+    else {
+      // Allocated with maximum size, so following blocks are appended in
+      // place and buffer can be reused for any write.
+      if (spare_buffers.empty()) {
+        requests.push_back({index, position, Buffer(kMaxWriteSize)});
+      }
+      else {
+        requests.push_back({index, position, move(spare_buffers.back())});
+        spare_buffers.pop_back();
+        requests.back().data.clear();
+      }
+      if (requests.back().data.capacity() < length)
+        requests.back().data.set_capacity(length);
+      Buffer& request_data = requests.back().data;
+      memcpy(request_data, data, length);
+      request_data.set_length(length);
+    }
+    pending_bytes += length;
+  }
+  queue_cv.notify_one();
+}
+
+void FileWriter::wait_for_budget()
+{
+  unique_lock<mutex> lock(queue_mutex);
+  budget_cv.wait(lock, [this] { return pending_bytes <= memory_budget; });
+}
+
+void FileWriter::collect_written(vector<WrittenPart>& written_parts)
+{
+  uint64_t counter;
+  if (read(notify_descriptor, &counter, sizeof(counter)) < 0)
+    {/* Nothing is written since last call. */}
+
+  // Copied instead of swapped, so both lists keep their capacity.
+  lock_guard<mutex> lock(queue_mutex);
+  written_parts.assign(this->written_parts.begin(), this->written_parts.end());
+  this->written_parts.clear();
+}
+
+int FileWriter::get_notify_descriptor() const noexcept
+{
+  return notify_descriptor;
+}
+
+size_t FileWriter::get_queue_depth() const
+{
+  lock_guard<mutex> lock(queue_mutex);
+  return requests.size();
+}
+
+size_t FileWriter::get_pending_bytes() const
+{
+  lock_guard<mutex> lock(queue_mutex);
+  return pending_bytes;
+}
+
+bool FileWriter::has_failed() const
+{
+  lock_guard<mutex> lock(queue_mutex);
+  return failed;
+}
+
+void FileWriter::stop()
+{
+  {
+    lock_guard<mutex> lock(queue_mutex);
+    keep_running = false;
+  }
+  queue_cv.notify_one();
+}
+
+size_t FileWriter::get_max_spare_buffers() const noexcept
+{
+  return max(memory_budget / kMaxWriteSize, kMinSpareBuffers);
+}
+
+void FileWriter::run()
+{
+  vector<WriteRequest> batch;
+  // Swapped with request queue, so both keep the reserved capacity.
+  batch.reserve(get_max_spare_buffers());
+  while (true) {
+    {
+      unique_lock<mutex> lock(queue_mutex);
+      queue_cv.wait(lock, [this] { return !requests.empty() || !keep_running; });
+      // Stopped and all data is written.
+      if (requests.empty())
+        break;
+      swap(batch, requests);
+    }
+
+    for (WriteRequest& request : batch)
+      request.failed = !file_io->write(request.data, request.position);
+
+    {
+      lock_guard<mutex> lock(queue_mutex);
+      for (WriteRequest& request : batch) {
+        const bool kPartFailed = find(failed_parts.begin(), failed_parts.end(),
+                                      request.index) != failed_parts.end();
+        if (request.failed && !kPartFailed)
+          failed_parts.push_back(request.index);
+        failed = failed || request.failed;
+        // Written bytes are credited from current position of part, bytes
+        // after a hole would be taken for it.
+        if (!request.failed && !kPartFailed)
+          written_parts.emplace_back(request.index, request.data.length());
+        pending_bytes -= request.data.length();
+        if (spare_buffers.size() < get_max_spare_buffers())
+          spare_buffers.push_back(move(request.data));
+      }
+    }
+    batch.clear();
+    budget_cv.notify_all();
+
+    const uint64_t kWritten = 1;
+    if (write(notify_descriptor, &kWritten, sizeof(kWritten)) < 0)
+      {/* Counter is already signaled. */}
+  }
+}
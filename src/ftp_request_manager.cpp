@@ -11,21 +11,40 @@ using namespace std;
 
 void FtpRequestManager::send_requests()
 {
-  lock_guard<mutex> lock(request_mutex);
+  // Forget finished logins.
+  logins.erase(remove_if(logins.begin(), logins.end(), [](future<void>& login) {
+                 return login.wait_for(chrono::seconds(0)) == future_status::ready;
+               }),
+               logins.end());
+
   for (Request& request : requests ) {
-    if (!request.sent) {
-      unique_ptr<SocketOps> sock_ops = connection_manager->acquire_sock_ops();
-      initialize(sock_ops.get(), connection_manager->get_path());
-      string ip_port_str = get_data_channel_addr(sock_ops.get());
-      pair<string, uint16_t> ip_port = get_ip_port_pair(ip_port_str);
-      unique_ptr<SocketOps> data_sock_ops = open_data_channel(ip_port.first,
-                                                              ip_port.second);
-      request.sent = send_ftp_requst(request, sock_ops.get());
-      notify_dwl_available(request.request_index, move(data_sock_ops));
+    if (!request.sent && logins.size() < kMaxConcurrentLogins) {
+      request.sent = true;
+      logins.push_back(async(launch::async, [this, request]() {
+        if (!start_transfer(request))
+          retry_request(request);
+        // Pending requests can use this worker.
+        wake_up();
+      }));
     }
   }
 }
 
+bool FtpRequestManager::start_transfer(const Request& request)
+{
+  unique_ptr<SocketOps> sock_ops = connection_manager->acquire_sock_ops();
+  initialize(sock_ops.get(), connection_manager->get_path());
+  string ip_port_str = get_data_channel_addr(sock_ops.get());
+  pair<string, uint16_t> ip_port = get_ip_port_pair(ip_port_str);
+  unique_ptr<SocketOps> data_sock_ops = open_data_channel(ip_port.first,
+                                                          ip_port.second);
+  if (!send_ftp_requst(request, sock_ops.get()))
+    return false;
+  notify_dwl_available(request.request_index, move(data_sock_ops));
+
+  return true;
+}
+
 string FtpRequestManager::get_data_channel_addr(SocketOps* sock_ops)
 {
   Buffer command(string("PASV\r\n"));
@@ -96,7 +115,7 @@ bool FtpRequestManager::send_ftp_requst(const Request& request,
     Buffer(string("RETR " + connection_manager->get_file_name()+ "\r\n"))
   };
 
-  for (Buffer command : commands) {
+  for (const Buffer& command : commands) {
     pair<bool, string> response = send_ftp_command(command, sock_ops);
     result &= response.first;
   }
@@ -2,6 +2,7 @@
 
 #include <array>
 #include <sstream>
+#include <cerrno>
 #include <cstring>
 
 using namespace std;
@@ -21,7 +22,7 @@ bool FtpTransceiver::send_init_commands(SocketOps* sock_ops)
   };
 
   string reply;
-  for (const auto command : init_commands) {
+  for (const Buffer& command : init_commands) {
     if (!send(command, sock_ops))
       cerr << "Ftp command sending error: " << reply << endl;
     else {
@@ -70,12 +71,14 @@ bool FtpTransceiver::receive(Buffer& buffer, SocketOps* sock_ops)
   recvd_bytes = plain_transceiver.receive(buffer,
                                           buffer.capacity(),
                                           sock_ops->get_socket_descriptor());
-  buffer.set_length(recvd_bytes);
-
-  if (recvd_bytes >= 0)
+  if (recvd_bytes >= 0) {
+    buffer.set_length(recvd_bytes);
     return true;
-  else
-    return false;
+  }
+
+  buffer.set_length(0);
+  // Non-blocking socket is drained, it is not an error.
+  return errno == EAGAIN || errno == EWOULDBLOCK;
 }
 
 bool FtpTransceiver::send(const Buffer& buffer, SocketOps* sock_ops)
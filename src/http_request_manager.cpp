@@ -6,27 +6,57 @@ using namespace std;
 
 void HttpRequestManager::send_requests()
 {
-  lock_guard<mutex> lock(request_mutex);
   for (Request& request : requests ) {
     if (!request.sent) {
-      unique_ptr<SocketOps> sock_ops = connection_manager->acquire_sock_ops();
-      Buffer request_buf = generate_request_str(request);
-      // TODO: check sent result
-      request.sent = transceiver->send(request_buf, sock_ops.get());
-      notify_dwl_available(request.request_index, move(sock_ops));
+      unique_ptr<SocketOps> sock_ops = connection_manager->acquire_idle_sock_ops();
+      if (sock_ops != nullptr) {
+        request.sent = on_connected(request, move(sock_ops));
+      }
+      else {
+        sock_ops = connection_manager->create_sock_ops();
+        // Sent during handshake of a resumed TLS session if possible.
+        Buffer request_buf = generate_request_str(request);
+        sock_ops->set_early_data(request_buf, request_buf.length());
+        connect_async(request, move(sock_ops));
+      }
     }
   }
 }
 
+bool HttpRequestManager::on_connected(const Request& request,
+                                      unique_ptr<SocketOps> sock_ops)
+{
+  Buffer request_buf = generate_request_str(request);
+  if (!transceiver->send(request_buf, sock_ops.get()))
+    return false;
+  notify_dwl_available(request.request_index, move(sock_ops));
+
+  return true;
+}
+
+void HttpRequestManager::release_sock_ops(unique_ptr<SocketOps> sock_ops)
+{
+  connection_manager->release_sock_ops(move(sock_ops));
+}
+
 Buffer HttpRequestManager::generate_request_str(const Request& request)
 {
   Buffer request_buffer;
   request_buffer << "GET " << connection_manager->get_path() << "/"
-          << connection_manager->get_file_name() << " HTTP/1.1\r\nRange: bytes="
-          << to_string(request.start_pos) << "-" << to_string(request.end_pos) << "\r\n"
-          << "User-Agent: no_name_yet!\r\n"
+          << connection_manager->get_file_name() << " HTTP/1.1\r\n";
+  // File of unknown size is streamed as a whole.
+  if (request.end_pos != StateManager::kUnknownFileSize) {
+    request_buffer << "Range: bytes=" << to_string(request.start_pos) << "-"
+                   << to_string(request.end_pos) << "\r\n";
+    // Changed file is sent whole instead of range, download is restarted.
+    const string kValidator = connection_manager->get_validator();
+    if (!kValidator.empty())
+      request_buffer << "If-Range: " << kValidator << "\r\n";
+  }
+  request_buffer << "User-Agent: no_name_yet!\r\n"
           << "Accept: */*\r\n"
           << "Accept-Encoding: identity\r\n"
+          << "Connection: keep-alive\r\n"
           << "Host:" << connection_manager->get_host_name() << ":"
           << connection_manager->get_port() << "\r\n\r\n";
   return request_buffer;
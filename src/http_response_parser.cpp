@@ -0,0 +1,413 @@
+#include "http_response_parser.h"
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr char kHeaderTerminator[] = "\r\n\r\n";
+constexpr size_t kHeaderTerminatorLength = sizeof(kHeaderTerminator) - 1;
+
+bool equals_ignore_case(string_view input, string_view lower_case)
+{
+  return input.length() == lower_case.length() &&
+         equal(input.begin(), input.end(), lower_case.begin(),
+               [](char a, char b) { return tolower(a) == b; });
+}
+
+bool contains_ignore_case(string_view input, string_view lower_case)
+{
+  return search(input.begin(), input.end(),
+                lower_case.begin(), lower_case.end(),
+                [](char a, char b) { return tolower(a) == b; }) != input.end();
+}
+
+// Removes optional white spaces around field value.
+string_view trim(string_view input)
+{
+  constexpr string_view kWhiteSpaces = " \t";
+  const size_t kStart = input.find_first_not_of(kWhiteSpaces);
+  if (kStart == string_view::npos)
+    return string_view();
+  const size_t kEnd = input.find_last_not_of(kWhiteSpaces);
+
+  return input.substr(kStart, kEnd - kStart + 1);
+}
+
+bool parse_number(string_view input, size_t& number)
+{
+  if (input.empty())
+    return false;
+
+  size_t result = 0;
+  for (char digit : input) {
+    if (digit < '0' || digit > '9')
+      return false;
+    const size_t kDigit = digit - '0';
+    if (result > (SIZE_MAX - kDigit) / 10)
+      return false;
+    result = result * 10 + kDigit;
+  }
+  number = result;
+
+  return true;
+}
+
+#ifdef __SSE2__
+// Terminator starting at each byte of a block is checked with four shifted
+// loads, so the terminator may cross blocks.
+size_t find_terminator_sse2(const char* data, size_t length)
+{
+  constexpr size_t kBlockSize = sizeof(__m128i);
+  const __m128i kCr = _mm_set1_epi8('\r');
+  const __m128i kLf = _mm_set1_epi8('\n');
+  size_t position = 0;
+  for (; position + kBlockSize + kHeaderTerminatorLength - 1 <= length;
+       position += kBlockSize) {
+    const char* kBlock = data + position;
+    const __m128i kByte0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kBlock));
+    const __m128i kByte1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kBlock + 1));
+    const __m128i kByte2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kBlock + 2));
+    const __m128i kByte3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kBlock + 3));
+    const __m128i kMatch =
+      _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(kByte0, kCr),
+                                  _mm_cmpeq_epi8(kByte1, kLf)),
+                    _mm_and_si128(_mm_cmpeq_epi8(kByte2, kCr),
+                                  _mm_cmpeq_epi8(kByte3, kLf)));
+    const unsigned kMask = _mm_movemask_epi8(kMatch);
+    if (kMask != 0)
+      return position + __builtin_ctz(kMask);
+  }
+
+  const size_t kTail = HttpResponseParser::find_header_terminator_scalar(
+      data + position, length - position);
+  return kTail == string_view::npos ? kTail : position + kTail;
+}
+
+__attribute__((target("avx2")))
+size_t find_terminator_avx2(const char* data, size_t length)
+{
+  constexpr size_t kBlockSize = sizeof(__m256i);
+  const __m256i kCr = _mm256_set1_epi8('\r');
+  const __m256i kLf = _mm256_set1_epi8('\n');
+  size_t position = 0;
+  for (; position + kBlockSize + kHeaderTerminatorLength - 1 <= length;
+       position += kBlockSize) {
+    const char* kBlock = data + position;
+    const __m256i kByte0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kBlock));
+    const __m256i kByte1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kBlock + 1));
+    const __m256i kByte2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kBlock + 2));
+    const __m256i kByte3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kBlock + 3));
+    const __m256i kMatch =
+      _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(kByte0, kCr),
+                                        _mm256_cmpeq_epi8(kByte1, kLf)),
+                       _mm256_and_si256(_mm256_cmpeq_epi8(kByte2, kCr),
+                                        _mm256_cmpeq_epi8(kByte3, kLf)));
+    const unsigned kMask = _mm256_movemask_epi8(kMatch);
+    if (kMask != 0)
+      return position + __builtin_ctz(kMask);
+  }
+
+  const size_t kTail = find_terminator_sse2(data + position, length - position);
+  return kTail == string_view::npos ? kTail : position + kTail;
+}
+#endif
+
+}   // namespace
+
+HttpResponseParser::HttpResponseParser()
+{
+  reset();
+}
+
+size_t HttpResponseParser::parse(const char* data, size_t length)
+{
+  if (state == State::COMPLETE || state == State::ERROR)
+    return 0;
+
+  // Header can't end after first terminator of block. It may end before it
+  // when terminator is split between blocks, lines are parsed to find out.
+  size_t header_end = find_header_terminator(data, length);
+  header_end = header_end == string_view::npos
+               ? length : header_end + kHeaderTerminatorLength;
+
+  size_t position = 0;
+  while (position < header_end &&
+         state != State::COMPLETE && state != State::ERROR) {
+    const char* kLineStart = data + position;
+    const char* kNewLine = static_cast<const char*>(
+        memchr(kLineStart, '\n', header_end - position));
+    const size_t kAvailable = kNewLine == nullptr ? header_end - position
+                                                  : kNewLine + 1 - kLineStart;
+    if (partial_line_length + kAvailable > kMaxLineLength) {
+      state = State::ERROR;
+      break;
+    }
+
+    // Rest of line comes with next block.
+    if (kNewLine == nullptr) {
+      memcpy(partial_line + partial_line_length, kLineStart, kAvailable);
+      partial_line_length += kAvailable;
+      position += kAvailable;
+      break;
+    }
+
+    string_view line(kLineStart, kAvailable - 1);
+    if (partial_line_length > 0) {
+      memcpy(partial_line + partial_line_length, kLineStart, kAvailable - 1);
+      line = string_view(partial_line, partial_line_length + kAvailable - 1);
+      partial_line_length = 0;
+    }
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    parse_line(line);
+    position += kAvailable;
+  }
+
+  return state == State::COMPLETE ? position : length;
+}
+
+void HttpResponseParser::reset()
+{
+  state = State::STATUS_LINE;
+  status_code = 0;
+  content_length = kUnknownLength;
+  content_range = ContentRange();
+  content_range_received = false;
+  ranges_accepted = false;
+  chunked = false;
+  persistent = true;
+  etag_length = 0;
+  last_modified_length = 0;
+  location_length = 0;
+  partial_line_length = 0;
+}
+
+HttpResponseParser::State HttpResponseParser::get_state() const noexcept
+{
+  return state;
+}
+
+bool HttpResponseParser::is_complete() const noexcept
+{
+  return state == State::COMPLETE;
+}
+
+bool HttpResponseParser::has_error() const noexcept
+{
+  return state == State::ERROR;
+}
+
+int HttpResponseParser::get_status_code() const noexcept
+{
+  return status_code;
+}
+
+size_t HttpResponseParser::get_content_length() const noexcept
+{
+  return content_length;
+}
+
+bool HttpResponseParser::has_content_range() const noexcept
+{
+  return content_range_received;
+}
+
+const HttpResponseParser::ContentRange&
+HttpResponseParser::get_content_range() const noexcept
+{
+  return content_range;
+}
+
+bool HttpResponseParser::accepts_ranges() const noexcept
+{
+  return ranges_accepted;
+}
+
+bool HttpResponseParser::is_chunked() const noexcept
+{
+  return chunked;
+}
+
+bool HttpResponseParser::is_persistent() const noexcept
+{
+  return persistent;
+}
+
+string_view HttpResponseParser::get_etag() const noexcept
+{
+  return string_view(etag, etag_length);
+}
+
+string_view HttpResponseParser::get_last_modified() const noexcept
+{
+  return string_view(last_modified, last_modified_length);
+}
+
+string_view HttpResponseParser::get_location() const noexcept
+{
+  return string_view(location, location_length);
+}
+
+size_t HttpResponseParser::find_header_terminator(const char* data,
+                                                  size_t length)
+{
+#ifdef __SSE2__
+  static const bool kAvx2 = __builtin_cpu_supports("avx2");
+  return kAvx2 ? find_terminator_avx2(data, length)
+               : find_terminator_sse2(data, length);
+#else
+  return find_header_terminator_scalar(data, length);
+#endif
+}
+
+size_t HttpResponseParser::find_header_terminator_scalar(const char* data,
+                                                         size_t length)
+{
+  const char* position = data;
+  const char* const kEnd = data + length;
+  while (static_cast<size_t>(kEnd - position) >= kHeaderTerminatorLength) {
+    position = static_cast<const char*>(
+        memchr(position, '\r', kEnd - position - kHeaderTerminatorLength + 1));
+    if (position == nullptr)
+      break;
+    if (memcmp(position, kHeaderTerminator, kHeaderTerminatorLength) == 0)
+      return position - data;
+    ++position;
+  }
+
+  return string_view::npos;
+}
+
+void HttpResponseParser::parse_line(string_view line)
+{
+  if (state == State::STATUS_LINE) {
+    parse_status_line(line);
+    return;
+  }
+
+  // Empty line terminates header.
+  if (line.empty()) {
+    state = State::COMPLETE;
+    return;
+  }
+  // Obsolete line folding, continuation of an ignored value.
+  if (line.front() == ' ' || line.front() == '\t')
+    return;
+
+  const size_t kColon = line.find(':');
+  if (kColon == string_view::npos) {
+    state = State::ERROR;
+    return;
+  }
+  parse_field(trim(line.substr(0, kColon)), trim(line.substr(kColon + 1)));
+}
+
+void HttpResponseParser::parse_status_line(string_view line)
+{
+  // Empty lines before status line are ignored.
+  if (line.empty())
+    return;
+
+  // HTTP/x.y SSS Reason
+  constexpr string_view kHttpVersion = "HTTP/";
+  constexpr size_t kStatusCodeLength = 3;
+  const size_t kSpace = line.find(' ');
+  if (line.substr(0, kHttpVersion.length()) != kHttpVersion ||
+      kSpace == string_view::npos) {
+    state = State::ERROR;
+    return;
+  }
+
+  size_t status_code = 0;
+  if (!parse_number(line.substr(kSpace + 1, kStatusCodeLength), status_code) ||
+      status_code < 100 || status_code > 999) {
+    state = State::ERROR;
+    return;
+  }
+  this->status_code = status_code;
+  persistent = line.substr(0, kSpace) != "HTTP/1.0";
+  state = State::HEADERS;
+}
+
+void HttpResponseParser::parse_field(string_view name, string_view value)
+{
+  if (equals_ignore_case(name, "content-length")) {
+    if (!parse_number(value, content_length))
+      state = State::ERROR;
+  }
+  else if (equals_ignore_case(name, "content-range")) {
+    content_range_received = parse_content_range(value);
+    if (!content_range_received)
+      state = State::ERROR;
+  }
+  else if (equals_ignore_case(name, "accept-ranges")) {
+    ranges_accepted = equals_ignore_case(value, "bytes");
+  }
+  else if (equals_ignore_case(name, "etag")) {
+    // Too long validators are ignored, so resumption is not validated.
+    if (value.length() <= kMaxETagLength) {
+      memcpy(etag, value.data(), value.length());
+      etag_length = value.length();
+    }
+  }
+  else if (equals_ignore_case(name, "last-modified")) {
+    if (value.length() <= kMaxLastModifiedLength) {
+      memcpy(last_modified, value.data(), value.length());
+      last_modified_length = value.length();
+    }
+  }
+  else if (equals_ignore_case(name, "transfer-encoding")) {
+    chunked = contains_ignore_case(value, "chunked");
+  }
+  else if (equals_ignore_case(name, "location")) {
+    // Fits, line length is limited to kMaxLineLength.
+    memcpy(location, value.data(), value.length());
+    location_length = value.length();
+  }
+  else if (equals_ignore_case(name, "connection")) {
+    if (contains_ignore_case(value, "close"))
+      persistent = false;
+    else if (contains_ignore_case(value, "keep-alive"))
+      persistent = true;
+  }
+}
+
+bool HttpResponseParser::parse_content_range(string_view value)
+{
+  // bytes <start>-<end>/<total>, or bytes */<total> if range is not
+  // satisfiable.
+  constexpr string_view kUnit = "bytes ";
+  if (!equals_ignore_case(value.substr(0, kUnit.length()), kUnit))
+    return false;
+  value = trim(value.substr(kUnit.length()));
+
+  const size_t kSlash = value.find('/');
+  if (kSlash == string_view::npos)
+    return false;
+  const string_view kRange = value.substr(0, kSlash);
+  const string_view kTotal = value.substr(kSlash + 1);
+
+  content_range.total = kUnknownLength;
+  if (kTotal != "*" && !parse_number(kTotal, content_range.total))
+    return false;
+
+  if (kRange == "*") {
+    content_range.start = kUnknownLength;
+    content_range.end = kUnknownLength;
+    return true;
+  }
+
+  const size_t kDash = kRange.find('-');
+  return kDash != string_view::npos &&
+         parse_number(kRange.substr(0, kDash), content_range.start) &&
+         parse_number(kRange.substr(kDash + 1), content_range.end) &&
+         content_range.start <= content_range.end;
+}
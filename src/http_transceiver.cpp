@@ -1,39 +1,107 @@
 #include "http_transceiver.h"
 
-#include <cstring>
+#include <cerrno>
 #include <iostream>
 
 using namespace std;
 
 bool HttpTransceiver::receive(Buffer& buffer, Connection& connection)
 {
-  bool result = true;
-  SocketOps* sock_ops = connection.socket_ops.get();
-  if (connection.header_skipped) {
-      result = receive(buffer, sock_ops);
-      return result;
+  if (receive(buffer, connection.socket_ops.get()))
+    return true;
+
+  on_connection_closed(connection);
+  return false;
+}
+
+size_t HttpTransceiver::skip_header(const Buffer& buffer,
+                                    Connection& connection)
+{
+  // Rest of a rejected response is dropped.
+  if (connection.status == OperationStatus::RESPONSE_ERROR)
+    return buffer.length();
+
+  HttpResponseParser& parser = connection.response_parser;
+  // Parsed in place, body is left where it is received.
+  const size_t kHeaderLength = parser.parse(const_cast<Buffer&>(buffer),
+                                            buffer.length());
+  if (parser.has_error()) {
+    cerr << "Invalid response header." << endl;
+    connection.status = OperationStatus::RESPONSE_ERROR;
+    connection.keep_alive = false;
+    return buffer.length();
   }
 
-  Buffer header_buffer;
-  while (!connection.header_skipped) {
-    result = receive(header_buffer, sock_ops);
-    if (result == false) {
-      cerr << "RECV ERROR" << endl;
-      break;
-    }
-    const ssize_t header_pos = get_header_terminator_pos(header_buffer,
-                                                         header_buffer.length());
-    if (header_pos > -1) {
-      buffer = header_buffer;
-      memcpy(buffer, static_cast<char*>(header_buffer) + header_pos,
-             header_buffer.length() - header_pos);
-      buffer.set_length(header_buffer.length() - header_pos);
-      connection.header_skipped = true;
-      break;
+  if (parser.is_complete()) {
+    // Body written at position of chunk must start there.
+    if (!matches_chunk(parser, connection.chunk)) {
+      cerr << "Response doesn't match requested range, status: "
+           << parser.get_status_code() << endl;
+      connection.status = OperationStatus::RESPONSE_ERROR;
+      connection.keep_alive = false;
+      return buffer.length();
     }
+    // Framing after last needed byte of a chunked body may stay unread.
+    if (!parser.is_persistent() || parser.is_chunked())
+      connection.keep_alive = false;
+    if (parser.get_content_length() == 0)
+      connection.end_of_body = true;
+    connection.header_skipped = true;
   }
 
-  return result;
+  return kHeaderLength;
+}
+
+bool HttpTransceiver::matches_chunk(const HttpResponseParser& parser,
+                                    const Chunk& chunk)
+{
+  if (parser.get_status_code() == 206)
+    return parser.has_content_range() &&
+           parser.get_content_range().start == chunk.current;
+
+  // Whole file, e.g. server ignores ranges or size is unknown.
+  return parser.get_status_code() == 200 && chunk.current == 0;
+}
+
+size_t HttpTransceiver::decode_body(char* data, size_t length,
+                                    Connection& connection)
+{
+  const HttpResponseParser& parser = connection.response_parser;
+  if (!parser.is_chunked()) {
+    // Body of known length ends with its last byte.
+    connection.body_bytes += length;
+    if (connection.header_skipped &&
+        parser.get_content_length() != HttpResponseParser::kUnknownLength &&
+        connection.body_bytes >= parser.get_content_length())
+      connection.end_of_body = true;
+    return length;
+  }
+
+  ChunkedDecoder& decoder = connection.chunked_decoder;
+  const size_t kDecodedLength = decoder.decode(data, length);
+  if (decoder.has_error()) {
+    cerr << "Invalid chunked response." << endl;
+    connection.status = OperationStatus::RESPONSE_ERROR;
+    connection.keep_alive = false;
+  }
+  if (decoder.is_finished())
+    connection.end_of_body = true;
+
+  return kDecodedLength;
+}
+
+void HttpTransceiver::on_connection_closed(Connection& connection)
+{
+  // Body without length and chunked coding ends when connection is closed.
+  const HttpResponseParser& parser = connection.response_parser;
+  if (connection.header_skipped && !parser.is_chunked() &&
+      parser.get_content_length() == HttpResponseParser::kUnknownLength)
+    connection.end_of_body = true;
+
+  // Rest of a chunked or known length body is lost.
+  if (!connection.end_of_body &&
+      connection.status != OperationStatus::RESPONSE_ERROR)
+    connection.status = OperationStatus::SOCKET_RECV_ERROR;
 }
 
 bool HttpTransceiver::send(const Buffer& buffer, Connection& connection)
@@ -46,29 +114,23 @@ bool HttpTransceiver::send(const Buffer& buffer, Connection& connection)
   return result;
 }
 
-ssize_t HttpTransceiver::get_header_terminator_pos(const char* buffer,
-                                                   size_t len) const
-{
-  const char* head_position = strstr(buffer, kHeaderTerminator);
-  if (head_position != nullptr)
-    //return head_position - buffer + strlen(kHeaderTerminator);
-    return head_position - buffer + 4;
-  else
-    return -1;
-}
-
 bool HttpTransceiver::receive(Buffer& buffer, SocketOps* sock_ops)
 {
   ssize_t recvd_bytes = 0;
   recvd_bytes = plain_transceiver.receive(buffer,
                                           buffer.capacity(),
                                           sock_ops->get_socket_descriptor());
-  buffer.set_length(recvd_bytes);
-
-  if (recvd_bytes >= 0)
+  if (recvd_bytes > 0) {
+    buffer.set_length(recvd_bytes);
     return true;
-  else
+  }
+
+  buffer.set_length(0);
+  // Connection is closed by server.
+  if (recvd_bytes == 0)
     return false;
+  // Non-blocking socket is drained, it is not an error.
+  return errno == EAGAIN || errno == EWOULDBLOCK;
 }
 
 bool HttpTransceiver::send(const Buffer& buffer, SocketOps* sock_ops)
@@ -1,5 +1,6 @@
 #include <iostream>
 
+#include "tls_context.h"
 #include "https_socket_ops.h"
 
 using namespace std;
@@ -7,68 +8,133 @@ using namespace std;
 HttpsSocketOps::HttpsSocketOps(const std::string& ip, uint16_t port,
                                const std::string& host)
   : SocketOps(ip, port)
+  , bio(nullptr)
+  , ssl(nullptr)
   , host(host)
+  , tcp_connected(false)
+  , handshake_wants_write(false)
+  , early_data_written(false)
+  , early_data_accepted(false)
 {
 }
 
-bool HttpsSocketOps::connect()
+HttpsSocketOps::~HttpsSocketOps()
 {
-    ctx = SSL_CTX_new(TLS_client_method());
-    if (SSL_CTX_set_default_verify_paths(ctx) != 1) 
-      cerr << "Error setting up trust store" << endl;
-
-    string destination = host + ":" + to_string(port);
-    bio = BIO_new_connect(destination.c_str());
-    if (BIO_do_connect(bio) <= 0)
-      cerr << "Error in BIO_do_connect" << endl;
-
-    BIO_get_fd(bio, &socket_descriptor);
-    BIO* new_bio = BIO_new_ssl(ctx, 1);
-    BIO_push(new_bio, bio);
-
-    SSL_set_tlsext_host_name(retrieve_ssl(new_bio), host.c_str());
-    SSL_set1_host(retrieve_ssl(new_bio), host.c_str());
-    if (BIO_do_handshake(new_bio) <= 0)
-      cerr << "Error in BIO_do_handshake" << endl;
-
-    // Verify the certificate.
-    SSL* verfy_ssl = retrieve_ssl(new_bio);
-    int err = SSL_get_verify_result(verfy_ssl);
-    if (err != X509_V_OK)
-      cerr << "Certificate verification error: " <<
-              X509_verify_cert_error_string(err) << "(" << err << ")" << endl;
-    X509 *cert = SSL_get_peer_certificate(verfy_ssl);
-    if (cert == nullptr)
-      cerr << "No certificate was presented by the server." << endl;
-
-    bio = new_bio;
-    ssl = retrieve_ssl(new_bio);
-
-    // TODO: handle errors.
-    return true;
+  // Frees ssl too, socket is closed by SocketOps.
+  if (bio != nullptr)
+    BIO_free_all(bio);
 }
 
-SSL* HttpsSocketOps::retrieve_ssl(BIO* bio)
+ConnectStatus HttpsSocketOps::start_connect()
 {
-  //retrieve
-  SSL* ssl = nullptr;
+  connect_time_point = chrono::steady_clock::now();
+  if (SocketOps::start_connect() == ConnectStatus::FAILED)
+    return ConnectStatus::FAILED;
 
-  BIO_get_ssl(bio, &ssl);
+  ssl = TlsContext::get_instance().new_ssl(host, port);
   if (ssl == nullptr)
-    cerr << "Error occurred when getting ssl." << endl;
+    return ConnectStatus::FAILED;
+  SSL_set_fd(ssl, socket_descriptor);
+  SSL_set_connect_state(ssl);
+  // Used for sending, owns ssl.
+  bio = BIO_new(BIO_f_ssl());
+  BIO_set_ssl(bio, ssl, BIO_CLOSE);
+
+  return continue_connect();
+}
 
-  return ssl;
+ConnectStatus HttpsSocketOps::continue_connect()
+{
+  if (!tcp_connected) {
+    ConnectStatus status = SocketOps::continue_connect();
+    if (status != ConnectStatus::CONNECTED)
+      return status;
+    tcp_connected = true;
+
+    if (!TlsContext::get_instance().early_data_possible(ssl))
+      early_data.clear();
+  }
+
+  // Early data goes with first flight of handshake, same buffer is written
+  // again until it's done.
+  if (!early_data.empty()) {
+    size_t written = 0;
+    const int kResult = SSL_write_early_data(ssl, early_data.data(),
+                                             early_data.length(), &written);
+    if (kResult != 1)
+      return get_handshake_status(kResult);
+    early_data.clear();
+    early_data_written = true;
+  }
+
+  const int kResult = SSL_do_handshake(ssl);
+  if (kResult != 1)
+    return get_handshake_status(kResult);
+
+  on_handshake_done();
+  // Rejected early data is discarded by server.
+  early_data_accepted = early_data_written &&
+      SSL_get_early_data_status(ssl) == SSL_EARLY_DATA_ACCEPTED;
+  return ConnectStatus::CONNECTED;
 }
 
-bool HttpsSocketOps::disconnect()
+ConnectStatus HttpsSocketOps::get_handshake_status(int result)
 {
-  BIO_ssl_shutdown(bio);
+  const int kError = SSL_get_error(ssl, result);
+  if (kError == SSL_ERROR_WANT_READ || kError == SSL_ERROR_WANT_WRITE) {
+    handshake_wants_write = kError == SSL_ERROR_WANT_WRITE;
+    return ConnectStatus::IN_PROGRESS;
+  }
+
+  cerr << "Error in SSL_do_handshake" << endl;
+  return ConnectStatus::FAILED;
+}
+
+bool HttpsSocketOps::connect_wants_write() const
+{
+  return !tcp_connected || handshake_wants_write;
+}
+
+void HttpsSocketOps::on_handshake_done()
+{
+  // Verify the certificate.
+  int err = SSL_get_verify_result(ssl);
+  if (err != X509_V_OK)
+    cerr << "Certificate verification error: " <<
+            X509_verify_cert_error_string(err) << "(" << err << ")" << endl;
+  X509 *cert = SSL_get_peer_certificate(ssl);
+  if (cert == nullptr)
+    cerr << "No certificate was presented by the server." << endl;
   X509_free(cert);
-  close(socket_descriptor);
-  SSL_CTX_free(ctx);
-  SSL_free(ssl);
+
+  TlsContext::get_instance().on_handshake_done(ssl,
+      chrono::duration_cast<chrono::microseconds>(
+          chrono::steady_clock::now() - connect_time_point));
+}
+
+void HttpsSocketOps::set_early_data(const char* buffer, size_t length)
+{
+  early_data.assign(buffer, length);
+}
+
+bool HttpsSocketOps::take_early_data_accepted()
+{
+  const bool kAccepted = early_data_accepted;
+  early_data_accepted = false;
+  return kAccepted;
+}
+
+bool HttpsSocketOps::disconnect()
+{
+  if (bio != nullptr) {
+    BIO_ssl_shutdown(bio);
+    BIO_free_all(bio);
+    bio = nullptr;
+    ssl = nullptr;
+  }
+  tcp_connected = false;
   // TODO: handle errors.
-  return true;
+  return SocketOps::disconnect();
 }
 
 BIO* HttpsSocketOps::get_bio() const
@@ -80,4 +146,3 @@ SSL* HttpsSocketOps::get_ssl() const
 {
   return ssl;
 }
-
@@ -12,24 +12,28 @@ bool HttpsTransceiver::receive(Buffer& buffer, SocketOps* sock_ops)
   ssize_t recvd_bytes = 0;
   SSL* ssl = static_cast<HttpsSocketOps*>(sock_ops)->get_ssl();
   recvd_bytes = secure_transceiver.receive(ssl, buffer, buffer.capacity());
-  string strbuf = string(buffer, recvd_bytes);
 
   if (recvd_bytes >= 0) {
     buffer.set_length(recvd_bytes);
     result = true;
   }
-  else
+  else {
+    buffer.set_length(0);
     result = false;
+  }
 
   return result;
 }
 
 bool HttpsTransceiver::send(const Buffer& buffer, SocketOps* sock_ops)
 {
-  bool result = true;
-  BIO* bio = dynamic_cast<HttpsSocketOps*>(sock_ops)->get_bio();
-  secure_transceiver.send(bio, const_cast<Buffer&>(buffer), buffer.length());
-
-  return result;
+  HttpsSocketOps* https_sock_ops = static_cast<HttpsSocketOps*>(sock_ops);
+  // Request is sent already in early data of handshake, early data which
+  // server rejected is sent again.
+  if (https_sock_ops->take_early_data_accepted())
+    return true;
+
+  const char* raw_buffer = const_cast<Buffer&>(buffer);
+  BIO* bio = https_sock_ops->get_bio();
+  return secure_transceiver.send(bio, raw_buffer, buffer.length());
 }
-
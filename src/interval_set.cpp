@@ -0,0 +1,88 @@
+#include "interval_set.h"
+
+#include <iterator>
+#include <algorithm>
+
+using namespace std;
+
+IntervalSet::IntervalSet() : length(0)
+{
+}
+
+void IntervalSet::insert(size_t start, size_t end)
+{
+  if (start >= end)
+    return;
+
+  auto next = ranges.upper_bound(start);
+  auto range = next;
+  if (next != ranges.begin() && prev(next)->second >= start) {
+    // Extends preceding range, the common case of a growing part.
+    range = prev(next);
+    if (range->second >= end)
+      return;
+    length += end - range->second;
+    range->second = end;
+  }
+  else {
+    range = ranges.emplace_hint(next, start, end);
+    length += end - start;
+  }
+
+  // Swallow following ranges which overlap or touch it.
+  while (next != ranges.end() && next->first <= range->second) {
+    length -= min(next->second, range->second) - next->first;
+    range->second = max(range->second, next->second);
+    next = ranges.erase(next);
+  }
+}
+
+bool IntervalSet::contains(size_t start, size_t end) const
+{
+  auto range = ranges.upper_bound(start);
+  if (range == ranges.begin())
+    return false;
+
+  return prev(range)->second >= end;
+}
+
+vector<pair<size_t, size_t>> IntervalSet::get_gaps(size_t begin,
+                                                   size_t end) const
+{
+  vector<pair<size_t, size_t>> gaps;
+  size_t position = begin;
+  auto range = ranges.upper_bound(begin);
+  if (range != ranges.begin())
+    position = max(position, prev(range)->second);
+
+  for (; range != ranges.end() && range->first < end; ++range) {
+    if (range->first > position)
+      gaps.emplace_back(position, range->first);
+    position = max(position, range->second);
+  }
+  if (position < end)
+    gaps.emplace_back(position, end);
+
+  return gaps;
+}
+
+size_t IntervalSet::get_length() const noexcept
+{
+  return length;
+}
+
+size_t IntervalSet::get_range_count() const noexcept
+{
+  return ranges.size();
+}
+
+bool IntervalSet::empty() const noexcept
+{
+  return ranges.empty();
+}
+
+void IntervalSet::clear()
+{
+  ranges.clear();
+  length = 0;
+}
@@ -88,7 +88,10 @@ void print_usage(int exit_code)
        << "\t-c                download continue" << endl
        << "\t-p --proxy        proxy address" << endl
        << "\t-l --speed_limit  download speed limit. [prefixes:k, m, g]"<< endl
-       << "\t-t --timeout      timeout interval" << endl;
+       << "\t-t --timeout      timeout interval" << endl
+       << "\t-e --engine       i/o engine [epoll, uring]" << endl
+       << "\t-s --sync         sync data and state on every checkpoint" << endl
+       << "\t-z --zero-rtt     send https requests in TLS 1.3 early data" << endl;
   exit(exit_code);
 }
 
@@ -131,10 +134,13 @@ int main(int argc, char* argv[])
   size_t speed_limit{0};
   string proxy_url;
   bool download_continue = false;
+  IoEngine io_engine = IoEngine::EPOLL;
+  CheckpointPolicy checkpoint_policy;
+  bool tls_early_data = false;
 
   //**************** get command line arguments ***************
   int next_option;
-  const char* const short_options = "hco:n:t:p:l:";
+  const char* const short_options = "hcszo:n:t:p:l:e:";
   const struct option long_options[] = {
     {"help",        0, nullptr, 'h'},
     {"output",      1, nullptr, 'o'},
@@ -142,6 +148,9 @@ int main(int argc, char* argv[])
     {"timeout",     1, nullptr, 't'},
     {"speed_limit", 1, nullptr, 'l'},
     {"proxy",       1, nullptr, 'p'},  // host:ip
+    {"engine",      1, nullptr, 'e'},
+    {"sync",        0, nullptr, 's'},
+    {"zero-rtt",    0, nullptr, 'z'},
     {nullptr,       0, nullptr, 0}
   };
   program_name = argv[0];
@@ -172,6 +181,18 @@ int main(int argc, char* argv[])
       case 'p':
         proxy_url = optarg;
         break;
+      case 's':
+        checkpoint_policy.durability = Durability::SYNC;
+        break;
+      case 'z':
+        tls_early_data = true;
+        break;
+      case 'e':
+        if (string(optarg) == "uring")
+          io_engine = IoEngine::IO_URING;
+        else if (string(optarg) != "epoll")
+          print_usage(1);
+        break;
       case '?':
         print_usage(1);
       case -1:
@@ -198,9 +219,18 @@ int main(int argc, char* argv[])
     node->set_proxy(proxy_url);
   node->set_speed_limit(speed_limit);
   node->set_resume(download_continue);
+  node->set_io_engine(io_engine);
+  node->set_checkpoint_policy(checkpoint_policy);
+  node->set_tls_early_data(tls_early_data);
   node->start();
   node->join();
 
   cout << endl;
+  if (node->get_ramp_up_time().count() > 0)
+    cout << "Ramp-up time: " << node->get_ramp_up_time().count() << " ms" << endl;
+  if (node->get_status() != OperationStatus::FINISHED) {
+    cerr << "Download is failed." << endl;
+    return 1;
+  }
   return 0;
 }
@@ -13,22 +13,38 @@
 #include "ftp_transceiver.h"
 #include "http_transceiver.h"
 #include "https_transceiver.h"
+#include "tls_context.h"
 #include "connection_manager.h"
 
 using namespace std;
 
 Node::Node(const string& url, const string& optional_path,
-           uint16_t number_of_parts, long int timeout)
+           size_t number_of_parts, long int timeout)
   : url(url)
   , optional_path(optional_path)
   , number_of_parts(number_of_parts)
   , timeout(timeout)
   , resume(false)
+  , io_engine(IoEngine::EPOLL)
+  , tls_early_data(false)
 {
   ++node_index;
 }
 
 void Node::run()
+{
+  TlsContext::get_instance().set_early_data(tls_early_data);
+  download();
+  for (size_t restarts = 0; status == OperationStatus::FILE_CHANGED &&
+                            restarts < kMaxRestarts; ++restarts) {
+    cerr << "File is changed on server, downloading it again." << endl;
+    // Received parts belong to former version of file.
+    resume = false;
+    download();
+  }
+}
+
+void Node::download()
 {
   unique_ptr<ConnectionManager> connection_manager;
   connection_manager = make_unique<ConnectionManager>(url);
@@ -45,19 +61,64 @@ void Node::run()
   unique_ptr<FileIO> stat_file_io = make_unique<FileIO>(paths.second);
 
   state_manager = make_shared<StateManager>(paths.second);
+  state_manager->set_checkpoint_policy(checkpoint_policy);
   bool state_file_available = state_manager->state_file_available();
   bool main_file_available = file_io->check_existence();
-  if (resume && state_file_available && main_file_available) { // Resuming download
+  // Size is unknown, e.g. chunked response. File is streamed by one part
+  // and grows as it's written.
+  const bool kStreaming = file_length == 0;
+  // Server that ignores ranges sends whole file to every part request.
+  const bool kRanges = connection_manager->supports_ranges();
+  const size_t kParts = kStreaming || !kRanges ? 1 : number_of_parts;
+  if (!kRanges && number_of_parts > 1)
+    cerr << "Server doesn't support ranges, downloading by one part." << endl;
+  if (resume && kStreaming)
+    cerr << "File size is unknown, download can't be resumed." << endl;
+  else if (resume && !kRanges)
+    cerr << "Server doesn't support ranges, download can't be resumed." << endl;
+
+  const string kValidator = connection_manager->get_validator();
+  bool resuming = !kStreaming && resume && kRanges && main_file_available;
+  if (resuming && state_file_available) {
     state_manager->retrieve();
+    // Received parts belong to former version of file.
+    resuming = state_manager->matches_remote_file(file_length, kValidator);
+    if (!resuming)
+      cerr << "File is changed on server, downloading it again." << endl;
+  }
+  else if (resuming) {
+    // State file is lost, received ranges are found from holes of file.
+    file_io->open();
+    resuming = file_io->get_size() == file_length &&
+               state_manager->recover(file_length, file_io->get_data_ranges(),
+                                      file_io->get_block_size());
+    if (resuming)
+      cerr << "State file is lost, " << state_manager->get_total_recvd_bytes()
+           << " bytes are recovered from " << file_name << endl;
+  }
+
+  if (kStreaming) {
+    file_io->create(0);
+    state_manager->create_streaming_state();
+  }
+  else if (resuming) {
     file_io->open();
   }
   else {  // Not resuming download, create chunks collection
     file_io->create(file_length);
     state_manager->create_new_state(file_length);
   }
+  // Former state files have no validator, it's stored for next resume.
+  if (!kStreaming)
+    state_manager->set_validator(kValidator);
 
-  if (number_of_parts == 1)
-    state_manager->set_chunk_size(file_length);
+  // Single part of a stream spans the whole stream.
+  if (!kStreaming) {
+    if (kParts == 1)
+      state_manager->set_chunk_size(file_length);
+    else
+      state_manager->set_chunk_size(chunk_size_policy.min_size);
+  }
 
   // Create and register callback
   CallBack callback = bind(&Node::on_data_received_node, this,
@@ -79,6 +140,10 @@ void Node::run()
       request_manager = make_unique<HttpRequestManager>(move(connection_manager),
                                                     make_unique<HttpsTransceiver>());
       transceiver = make_unique<HttpsTransceiver>();
+      if (io_engine == IoEngine::IO_URING) {
+        cerr << "io_uring engine doesn't support https, using epoll." << endl;
+        io_engine = IoEngine::EPOLL;
+      }
       break;
     case Protocol::FTP:
       request_manager = make_unique<FtpRequestManager>(move(connection_manager),
@@ -90,11 +155,15 @@ void Node::run()
   Downloader downloader(move(request_manager), state_manager, move(file_io),
                         move(transceiver));
   downloader.register_callback(callback);
-  downloader.set_parts(number_of_parts);
+  downloader.set_parts(kParts);
   downloader.set_speed_limit(speed_limit);
+  downloader.set_io_engine(io_engine);
+  downloader.set_chunk_size_policy(chunk_size_policy);
 
   downloader.start();
   downloader.join();
+  ramp_up_time = downloader.get_ramp_up_time();
+  status = downloader.get_status();
 }
 
 pair<string, string> Node::get_output_paths(const string& file_name)
@@ -156,11 +225,46 @@ void Node::set_resume(bool resume)
   this->resume = resume;
 }
 
-void Node::set_parts(uint16_t parts)
+void Node::set_parts(size_t parts)
 {
   number_of_parts = parts;
 }
 
+void Node::set_io_engine(IoEngine io_engine)
+{
+  this->io_engine = io_engine;
+}
+
+void Node::set_checkpoint_policy(const CheckpointPolicy& checkpoint_policy)
+{
+  this->checkpoint_policy = checkpoint_policy;
+}
+
+void Node::set_chunk_size_policy(const ChunkSizePolicy& chunk_size_policy)
+{
+  this->chunk_size_policy = chunk_size_policy;
+  if (chunk_size_policy.min_size < StateManager::kMinChunkSize) {
+    cerr << "Minimum chunk size is raised to " << StateManager::kMinChunkSize
+         << " bytes." << endl;
+    this->chunk_size_policy.min_size = StateManager::kMinChunkSize;
+  }
+}
+
+void Node::set_tls_early_data(bool enabled)
+{
+  tls_early_data = enabled;
+}
+
+chrono::milliseconds Node::get_ramp_up_time() const
+{
+  return ramp_up_time;
+}
+
+OperationStatus Node::get_status() const
+{
+  return status;
+}
+
 void Node::on_data_received_node(size_t speed)
 {
   size_t total_received_bytes = 0;
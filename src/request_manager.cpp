@@ -1,11 +1,21 @@
 #include "request_manager.h"
 
+#include <limits>
+#include <algorithm>
 #include <iostream>
 
 #include "socket_ops.h"
+#include "epoll_event_loop.h"
 
 using namespace std;
 
+namespace {
+
+// Event loop key of wakeup event.
+constexpr size_t kWakeupKey = numeric_limits<size_t>::max();
+
+}   // namespace
+
 RequestManager::RequestManager(unique_ptr<ConnectionManager> connection_manager,
                                unique_ptr<Transceiver> transceiver)
   : connection_manager(move(connection_manager))
@@ -13,12 +23,17 @@ RequestManager::RequestManager(unique_ptr<ConnectionManager> connection_manager,
   , proxy_host("")
   , proxy_port(0)
   , keep_running(true)
+  , request_queue(make_unique<MpscQueue<Request>>(kDefaultQueueCapacity))
+  , event_loop(make_unique<EpollEventLoop>())
 {
+  event_loop->add(wakeup_event.get_descriptor(), kWakeupKey);
+  requests.reserve(request_queue->get_capacity());
 }
 
 void RequestManager::stop()
 {
   keep_running.store(false);
+  wake_up();
 }
 
 void RequestManager::set_proxy(string& host, uint32_t port)
@@ -28,11 +43,29 @@ void RequestManager::set_proxy(string& host, uint32_t port)
 }
 
 void RequestManager::add_request(size_t start_pos, size_t end_pos,
-                                 uint16_t request_index)
+                                 size_t request_index)
+{
+  request_queue->push(Request{0, end_pos, start_pos, request_index});
+  wake_up();
+}
+
+void RequestManager::set_queue_capacity(size_t capacity)
 {
-  lock_guard<mutex> lock(request_mutex);
-  const Request request{0, end_pos, start_pos, request_index};
-  requests.push_back(request);
+  request_queue = make_unique<MpscQueue<Request>>(capacity);
+  requests.reserve(request_queue->get_capacity());
+}
+
+QueueStats RequestManager::get_queue_stats() const
+{
+  return request_queue->get_stats();
+}
+
+ProbeResponse RequestManager::take_probe_response()
+{
+  if (connection_manager == nullptr)
+    return ProbeResponse();
+
+  return connection_manager->take_probe_response();
 }
 
 void RequestManager::register_dwl_notify_cb(DwlAvailNotifyCB dwl_notify_cb)
@@ -43,32 +76,102 @@ void RequestManager::register_dwl_notify_cb(DwlAvailNotifyCB dwl_notify_cb)
 void RequestManager::run()
 {
   while (keep_running) {
-    if (!request_available()) {
-      // TODO implement conditional variable.
-      this_thread::sleep_for(chrono::milliseconds(100));
-      continue;
+    collect_requests();
+    if (!requests.empty()) {
+      send_requests();
+      remove_sent_requests();
     }
-    send_requests();
-    remove_sent_requests();
+    // Requests which couldn't be sent are tried again shortly.
+    wait_events(requests.empty() ? kIdleWaitMs : kRetryWaitMs);
   }
 }
 
-bool RequestManager::request_available()
+void RequestManager::retry_request(Request request)
 {
-  lock_guard<mutex> lock(request_mutex);
-  return !requests.empty();
+  request.sent = false;
+  request_queue->push(request);
+  wake_up();
 }
 
-void RequestManager::remove_sent_requests()
+void RequestManager::wake_up()
+{
+  wakeup_event.notify();
+}
+
+void RequestManager::connect_async(Request& request,
+                                   unique_ptr<SocketOps> sock_ops)
+{
+  ConnectStatus status = sock_ops->start_connect();
+  if (status == ConnectStatus::CONNECTED) {
+    if (sock_ops->set_non_blocking(false))
+      request.sent = on_connected(request, move(sock_ops));
+    return;
+  }
+
+  const int kSockDesc = sock_ops->get_socket_descriptor();
+  if (status == ConnectStatus::FAILED ||
+      !event_loop->add(kSockDesc, request.request_index, true)) {
+    cerr << "Connecting request " << request.request_index << " failed." << endl;
+    return;
+  }
+  connecting.erase(request.request_index);
+  connecting.emplace(request.request_index, make_pair(request, move(sock_ops)));
+  request.sent = true;
+}
+
+bool RequestManager::on_connected(const Request& request,
+                                  unique_ptr<SocketOps> sock_ops)
+{
+  notify_dwl_available(request.request_index, move(sock_ops));
+  return true;
+}
+
+void RequestManager::wait_events(int timeout_ms)
 {
-  using RequestIt = vector<Request>::iterator;
-  vector<RequestIt> sent_requests;
+  if (event_loop->wait(ready_keys, timeout_ms) == -1)
+    cerr << "Event loop error occurred." << endl;
 
-  for (RequestIt it = requests.begin(); it != requests.end(); ++it)
-    if (it->sent)
-      sent_requests.push_back(it);
+  for (size_t index : ready_keys) {
+    if (index == kWakeupKey) {
+      wakeup_event.reset();
+      continue;
+    }
+    auto connecting_it = connecting.find(index);
+    if (connecting_it == connecting.end())
+      continue;
+
+    SocketOps* sock_ops = connecting_it->second.second.get();
+    ConnectStatus status = sock_ops->continue_connect();
+    if (status == ConnectStatus::IN_PROGRESS)
+      continue;
 
-  for (auto it : sent_requests)
-    requests.erase(it);
+    event_loop->remove(sock_ops->get_socket_descriptor());
+    Request request = connecting_it->second.first;
+    unique_ptr<SocketOps> connected_sock_ops = move(connecting_it->second.second);
+    connecting.erase(connecting_it);
+
+    bool sent = false;
+    if (status == ConnectStatus::CONNECTED &&
+        connected_sock_ops->set_non_blocking(false))
+      sent = on_connected(request, move(connected_sock_ops));
+
+    if (!sent) {
+      cerr << "Connecting request " << index << " failed." << endl;
+      retry_request(request);
+    }
+  }
+}
+
+void RequestManager::collect_requests()
+{
+  Request request;
+  while (request_queue->try_pop(request))
+    requests.push_back(request);
 }
 
+void RequestManager::remove_sent_requests()
+{
+  requests.erase(remove_if(requests.begin(), requests.end(),
+                           [](const Request& request) { return request.sent; }),
+                 requests.end());
+}
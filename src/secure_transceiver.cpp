@@ -8,8 +8,13 @@ ssize_t SecureTransceiver::receive(SSL* ssl, char* buffer, const size_t len)
   ssize_t recvd_bytes = 0;
   recvd_bytes = SSL_read(ssl, buffer, len);
   if (recvd_bytes <= 0) {
-    //cerr << "error SSL_read" << endl;
-    // TODO: SSL_get_error()
+    const int error = SSL_get_error(ssl, recvd_bytes);
+    // Non-blocking socket is drained, it is not an error.
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+      recvd_bytes = 0;
+    // Connection is closed or failed.
+    else
+      recvd_bytes = -1;
   }
 
   return recvd_bytes;
@@ -21,18 +26,25 @@ bool SecureTransceiver::send(BIO* bio, const char* buffer, const size_t len)
   int64_t sent_bytes = 0;
 
   while (static_cast<size_t>(sent_bytes) < len) {
-    int64_t temp_sent_bytes = BIO_write(bio, buffer, len);
-    if (temp_sent_bytes > 0)
+    int64_t temp_sent_bytes = BIO_write(bio, buffer + sent_bytes,
+                                        len - sent_bytes);
+    if (temp_sent_bytes > 0) {
       sent_bytes += temp_sent_bytes;
+    }
     else if(temp_sent_bytes == -2) {
       cerr << "Operation not implemented in the specific BIO type." << endl;
       result = false;
       break;
     }
+    else if (!BIO_should_retry(bio)) {
+      cerr << "Sending failed." << endl;
+      result = false;
+      break;
+    }
   }
 
-  BIO_flush(bio);
+  if (result && BIO_flush(bio) <= 0)
+    result = false;
 
   return result;
 }
-
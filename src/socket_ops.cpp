@@ -1,43 +1,78 @@
 #include "socket_ops.h"
 
+#include <poll.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+#include <cerrno>
 #include <cstring>
 
 using namespace std;
 
 SocketOps::~SocketOps()
 {
-  close(socket_descriptor);
+  if (socket_descriptor != -1)
+    close(socket_descriptor);
 }
 
 SocketOps::SocketOps(const string& ip, uint16_t port)
-  : socket_descriptor(0), ip(ip), port(port)
+  : socket_descriptor(-1), ip(ip), port(port)
 {
 }
 
 bool SocketOps::connect()
 {
-  bool result = false;
-  socket_descriptor = socket(AF_INET, SOCK_STREAM, 0);
-
-  if (socket_descriptor > 0) {
-    struct sockaddr_in dest_addr;
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(port);
-    dest_addr.sin_addr.s_addr = inet_addr(ip.c_str());
-    memset(&(dest_addr.sin_zero), '\0', sizeof(dest_addr.sin_zero));
-
-    socklen_t addr_len = sizeof(struct sockaddr);
-    struct sockaddr* address = reinterpret_cast<struct sockaddr*>(&dest_addr);
-    if (::connect(socket_descriptor, address, addr_len) == 0)
-      result = true;
+  ConnectStatus status = start_connect();
+  while (status == ConnectStatus::IN_PROGRESS) {
+    pollfd poll_fd{socket_descriptor,
+                   static_cast<short>(connect_wants_write() ? POLLOUT : POLLIN),
+                   0};
+    if (poll(&poll_fd, 1, -1) == -1 && errno != EINTR)
+      return false;
+    status = continue_connect();
   }
 
-  return result;
+  return status == ConnectStatus::CONNECTED && set_non_blocking(false);
+}
+
+ConnectStatus SocketOps::start_connect()
+{
+  socket_descriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (socket_descriptor < 0)
+    return ConnectStatus::FAILED;
+
+  return SocketOps::continue_connect();
+}
+
+ConnectStatus SocketOps::continue_connect()
+{
+  struct sockaddr_in dest_addr;
+  dest_addr.sin_family = AF_INET;
+  dest_addr.sin_port = htons(port);
+  dest_addr.sin_addr.s_addr = inet_addr(ip.c_str());
+  memset(&(dest_addr.sin_zero), '\0', sizeof(dest_addr.sin_zero));
+
+  socklen_t addr_len = sizeof(struct sockaddr);
+  struct sockaddr* address = reinterpret_cast<struct sockaddr*>(&dest_addr);
+  // Repeated connect reports state of pending connection.
+  if (::connect(socket_descriptor, address, addr_len) == 0 || errno == EISCONN)
+    return ConnectStatus::CONNECTED;
+  if (errno == EINPROGRESS || errno == EALREADY || errno == EINTR)
+    return ConnectStatus::IN_PROGRESS;
+
+  return ConnectStatus::FAILED;
+}
+
+bool SocketOps::connect_wants_write() const
+{
+  return true;
+}
+
+void SocketOps::set_early_data(const char* buffer, size_t length)
+{
 }
 
 bool SocketOps::disconnect()
@@ -46,6 +81,7 @@ bool SocketOps::disconnect()
 
   if (close(socket_descriptor) == 0)
     result = true;
+  socket_descriptor = -1;
 
   return result;
 }
@@ -55,6 +91,26 @@ int SocketOps::get_socket_descriptor() const noexcept
   return socket_descriptor;
 }
 
+bool SocketOps::set_non_blocking(bool non_blocking)
+{
+  int flags = fcntl(socket_descriptor, F_GETFL, 0);
+  if (flags == -1)
+    return false;
+
+  flags = non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+
+  return fcntl(socket_descriptor, F_SETFL, flags) == 0;
+}
+
+bool SocketOps::is_reusable() const
+{
+  char byte;
+  const ssize_t result = recv(socket_descriptor, &byte, 1,
+                              MSG_PEEK | MSG_DONTWAIT);
+  // 0 means connection is closed by peer.
+  return result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
 void SocketOps::set_http_proxy(const std::string& host, uint16_t port)
 {
   http_proxy_host = host;
@@ -1,10 +1,54 @@
 #include "state_manager.h"
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Binary .stat file layout:
+//   <magic: 4 bytes> <version: uint32> <file size: uint64>
+//   Since version 2:
+//   <validator length: uint64> <validator: kMaxValidatorLength bytes>
+//   Since version 3:
+//   <frontier: uint64>
+//   Record of an unfinished part in slot i at header size + i * kRecordSize:
+//   <index: uint64> <start: uint64> <current: uint64> <end: uint64>
+// Range below frontier which is not in a record is received. Empty slots
+// have kEmptyRecord index, before version 3 part i is in slot i and other
+// slots are empty.
+constexpr char kStateMagic[] = {'D', 'M', 'S', 'T'};
+constexpr size_t kFileSizeOffset = sizeof(kStateMagic) + sizeof(uint32_t);
+constexpr size_t kValidatorOffset = kFileSizeOffset + sizeof(uint64_t);
+constexpr size_t kFrontierOffset = kValidatorOffset + sizeof(uint64_t) +
+                                   StateManager::kMaxValidatorLength;
+constexpr size_t kHeaderSizeV1 = kValidatorOffset;
+constexpr size_t kHeaderSizeV2 = kFrontierOffset;
+constexpr size_t kHeaderSize = kFrontierOffset + sizeof(uint64_t);
+constexpr size_t kRecordSize = 4 * sizeof(uint64_t);
+constexpr size_t kCurrentOffset = 2 * sizeof(uint64_t);
+constexpr uint64_t kEmptyRecord = numeric_limits<uint64_t>::max();
+
+size_t record_position(size_t slot, size_t header_size = kHeaderSize)
+{
+  return header_size + slot * kRecordSize;
+}
 
-Chunk::Chunk() : start(0), current(0), end(0), finished(false)
+uint64_t read_uint64(const char* buffer)
+{
+  uint64_t value;
+  memcpy(&value, buffer, sizeof(value));
+  return value;
+}
+
+}   // namespace
+
+Chunk::Chunk() : start(0), current(0), end(0), dirty(false), slot(0)
 {
 }
 
@@ -12,7 +56,8 @@ Chunk::Chunk(size_t start, size_t current, size_t end)
   : start(start)
   , current(current)
   , end(end)
-  , finished(false)
+  , dirty(false)
+  , slot(0)
 {
 }
 
@@ -25,15 +70,20 @@ bool Chunk::operator==(const Chunk& rhs) const
 
 StateManager::~StateManager()
 {
-  if (total_recvd_bytes >= download_file_size)
+  if (get_total_recvd_bytes() >= download_file_size)
     state_file->remove();
 }
 
 StateManager::StateManager(const string& file_path)
-  : download_file_size(0)
-  , total_recvd_bytes(0)
+  : next_part_index(0)
+  , frontier(0)
+  , download_file_size(0)
   , chunk_size(kMinChunkSize)
   , inited(false)
+  , data_file(nullptr)
+  , slot_count(0)
+  , bytes_since_checkpoint(0)
+  , last_checkpoint(steady_clock::now())
 {
   state_file = make_unique<FileIO>(file_path);
 }
@@ -49,51 +99,74 @@ bool StateManager::state_file_available() const
 
 bool StateManager::part_available() const
 {
-  bool new_part = true;
-  if (parts.size() > 0) {
-    Chunk last_chunk = parts.rbegin()->second;
-    size_t last_chunk_size = last_chunk.end - last_chunk.current;
-    new_part = (last_chunk.end != download_file_size) || 
-               (last_chunk_size > chunk_size);
-  }
+  bool new_part = frontier < download_file_size;
 
   return (new_part && download_file_size > 0) ||
           initial_parts.size() > 0;
 }
 
 pair<size_t, Chunk> StateManager::get_part()
+{
+  return get_part(chunk_size);
+}
+
+pair<size_t, Chunk> StateManager::get_part(size_t chunk_size)
 {
   if (!part_available())
     throw runtime_error("new part not available.");
 
-  pair<size_t, Chunk> new_part;
-
   if (initial_parts.size() > 0) {
-    pair<size_t, Chunk> pop_part = initial_parts.front();
+    const size_t kIndex = initial_parts.front();
     initial_parts.pop();
-    if (pop_part.second.end == download_file_size) {
-      size_t new_chunk_size = pop_part.second.end - pop_part.second.current;
-      if (new_chunk_size > chunk_size)
-        pop_part.second.end = pop_part.second.current + chunk_size;
-    }
-    new_part = pop_part;
-  }
-  else {
-    if (parts.size() == 0) {
-      new_part.first = 0;
-      new_part.second = Chunk(0, 0, chunk_size);
-    }
-    else {
-      map<size_t, Chunk>::reverse_iterator last_part = parts.rbegin();
-      Chunk last_chunk = last_part->second;
-      new_part.first = last_part->first + 1;
-      size_t end = last_chunk.end + chunk_size;
-      if (end > download_file_size) // Check for last chunk
-        end = download_file_size;
-      new_part.second = Chunk(last_chunk.end, last_chunk.end + 1, end);
+    Chunk& chunk = parts.at(kIndex);
+    if (chunk.end == download_file_size &&
+        chunk.end - chunk.current > chunk_size) {
+      // Frontier moves back first, so rest of file is never taken as
+      // received if record is stored and frontier is not.
+      chunk.end = chunk.current + chunk_size;
+      frontier = chunk.end;
+      store_frontier();
+      store_record(kIndex);
     }
+    return make_pair(kIndex, chunk);
   }
+
+  pair<size_t, Chunk> new_part;
+  new_part.first = next_part_index++;
+  size_t end = frontier + chunk_size;
+  if (end > download_file_size) // Check for last chunk
+    end = download_file_size;
+  if (frontier == 0)
+    new_part.second = Chunk(0, 0, end);
+  else
+    new_part.second = Chunk(frontier, frontier + 1, end);
+  new_part.second.slot = allocate_slot();
+  frontier = end;
+  parts[new_part.first] = new_part.second;
+  // Record covers new range before frontier moves over it.
+  store_record(new_part.first);
+  store_frontier();
+
+  return new_part;
+}
+
+pair<size_t, Chunk> StateManager::split_part(size_t index, size_t split_position)
+{
+  auto part = parts.find(index);
+  if (part == parts.end() || split_position < part->second.current ||
+      split_position >= part->second.end)
+    throw runtime_error("StateManager: invalid split position.");
+
+  Chunk& chunk = part->second;
+  pair<size_t, Chunk> new_part(next_part_index++,
+                               Chunk(split_position, split_position + 1,
+                                     chunk.end));
+  new_part.second.slot = allocate_slot();
+  chunk.end = split_position;
   parts[new_part.first] = new_part.second;
+  // Tail is stored before it's removed from original part.
+  store_record(new_part.first);
+  store_record(index);
 
   return new_part;
 }
@@ -103,14 +176,46 @@ void StateManager::create_new_state(size_t download_file_size)
   if (download_file_size == 0)
     throw runtime_error("StateManager: File size should not be zero.");
 
-  parts.clear();
+  clear_parts();
   this->download_file_size = download_file_size;
   inited = true;
+  store();
+}
+
+void StateManager::create_streaming_state()
+{
+  clear_parts();
+  download_file_size = kUnknownFileSize;
+  chunk_size = kUnknownFileSize;
+  inited = true;
+  store();
+}
+
+bool StateManager::is_streaming() const
+{
+  return download_file_size == kUnknownFileSize;
+}
+
+void StateManager::finish_stream(size_t file_size)
+{
+  download_file_size = file_size;
+  frontier = file_size;
+  for (auto part = parts.begin(); part != parts.end();) {
+    part->second.end = file_size;
+    if (part->second.current >= file_size) {
+      erased_slots.push_back(part->second.slot);
+      part = parts.erase(part);
+      continue;
+    }
+    mark_dirty(part->first);
+    ++part;
+  }
+  store_header();
 }
 
 void StateManager::set_chunk_size(size_t chunk_size)
 {
-  if (chunk_size > kMinChunkSize)
+  if (chunk_size >= kMinChunkSize)
     this->chunk_size = chunk_size;
 }
 
@@ -126,12 +231,50 @@ size_t StateManager::get_file_size() const
 
 size_t StateManager::get_total_recvd_bytes() const
 {
-  return total_recvd_bytes;
+  return completed_ranges.get_length();
+}
+
+const IntervalSet& StateManager::get_completed_ranges() const
+{
+  return completed_ranges;
+}
+
+void StateManager::set_validator(const string& validator)
+{
+  // Without room for it, file can't be validated.
+  if (validator.length() > kMaxValidatorLength)
+    this->validator.clear();
+  else
+    this->validator = validator;
+
+  if (inited)
+    store_header();
+}
+
+string StateManager::get_validator() const
+{
+  return validator;
+}
+
+bool StateManager::matches_remote_file(size_t file_size,
+                                       const string& validator) const
+{
+  if (file_size != download_file_size)
+    return false;
+
+  return this->validator.empty() || validator.empty() ||
+         this->validator == validator;
 }
 
 queue<pair<size_t, Chunk>> StateManager::get_initial_parts() const
 {
-  return initial_parts;
+  queue<size_t> initial_parts = this->initial_parts;
+  queue<pair<size_t, Chunk>> retrieved_parts;
+  for (; !initial_parts.empty(); initial_parts.pop())
+    retrieved_parts.emplace(initial_parts.front(),
+                            parts.at(initial_parts.front()));
+
+  return retrieved_parts;
 }
 
 void StateManager::retrieve()
@@ -140,8 +283,64 @@ void StateManager::retrieve()
     throw runtime_error("*.stat file not available.");
 
   state_file->open();
-  parts.clear();
-  istringstream file_contents(state_file->get_file_contents());
+  clear_parts();
+  validator.clear();
+  const string kContents = state_file->get_file_contents();
+  if (kContents.compare(0, sizeof(kStateMagic), kStateMagic,
+                        sizeof(kStateMagic)) == 0) {
+    // Convert former binary format.
+    if (read_binary_state(kContents) < kStateVersion)
+      store();
+  }
+  else {
+    read_text_state(kContents);
+    // Convert former text format.
+    store();
+  }
+  rebuild_completed_ranges();
+
+  inited = true;
+}
+
+bool StateManager::recover(size_t file_size,
+                           const vector<pair<size_t, size_t>>& data_ranges,
+                           size_t block_size)
+{
+  if (data_ranges.empty() ||
+      (data_ranges.front().first == 0 && data_ranges.front().second >= file_size))
+    return false;
+
+  // Written ranges without their edge blocks.
+  vector<pair<size_t, size_t>> written_ranges;
+  for (auto [start, end] : data_ranges) {
+    if (start > 0)
+      start += block_size;
+    end = min(end, file_size);
+    end = end > block_size ? end - block_size : 0;
+    if (start < end)
+      written_ranges.emplace_back(start, end);
+  }
+  if (written_ranges.empty())
+    return false;
+
+  // Parts span gaps between written ranges, end of last part is file size.
+  clear_parts();
+  download_file_size = file_size;
+  for (auto [start, end] : written_ranges)
+    completed_ranges.insert(start, end);
+  for (auto [start, end] : completed_ranges.get_gaps(0, file_size)) {
+    const size_t kEnd = end < file_size ? end - 1 : file_size;
+    add_retrieved_part(next_part_index, Chunk(start, start, kEnd), 0);
+  }
+  inited = true;
+  store();
+
+  return true;
+}
+
+void StateManager::read_text_state(const string& contents)
+{
+  istringstream file_contents(contents);
   file_contents >> download_file_size;
 
   Chunk chunk;
@@ -150,65 +349,265 @@ void StateManager::retrieve()
     if (index < 0)
       break;
 
-    total_recvd_bytes += (chunk.current - chunk.start);
+    add_retrieved_part(index, chunk, index);
+  }
+}
 
-    parts[index] = chunk;
-    if (chunk.current < chunk.end)
-      initial_parts.push(make_pair(index, chunk));
+uint32_t StateManager::read_binary_state(const string& contents)
+{
+  if (contents.length() < kHeaderSizeV1)
+    throw runtime_error("*.stat file is corrupted.");
+
+  uint32_t version;
+  memcpy(&version, contents.data() + sizeof(kStateMagic), sizeof(version));
+  if (version > kStateVersion)
+    throw runtime_error("*.stat file version is not supported.");
+  size_t state_header_size = kHeaderSize;
+  if (version < 2)
+    state_header_size = kHeaderSizeV1;
+  else if (version < 3)
+    state_header_size = kHeaderSizeV2;
+  if (contents.length() < state_header_size)
+    throw runtime_error("*.stat file is corrupted.");
+  download_file_size = read_uint64(contents.data() + kFileSizeOffset);
+
+  if (version >= 2) {
+    const size_t kValidatorLength = read_uint64(contents.data() +
+                                                kValidatorOffset);
+    if (kValidatorLength > kMaxValidatorLength)
+      throw runtime_error("*.stat file is corrupted.");
+    validator.assign(contents.data() + kValidatorOffset + sizeof(uint64_t),
+                     kValidatorLength);
   }
+  if (version >= 3)
+    frontier = read_uint64(contents.data() + kFrontierOffset);
+
+  const size_t kRecords = (contents.length() - state_header_size) / kRecordSize;
+  for (size_t slot = 0; slot < kRecords; ++slot) {
+    const char* record = contents.data() + record_position(slot,
+                                                           state_header_size);
+    const size_t kIndex = read_uint64(record);
+    if (version < 3 ? kIndex != slot : kIndex == kEmptyRecord) {
+      free_slots.push_back(slot);
+      continue;
+    }
 
-  initial_index = index;
-  inited = true;
+    Chunk chunk(read_uint64(record + sizeof(uint64_t)),
+                read_uint64(record + kCurrentOffset),
+                read_uint64(record + 3 * sizeof(uint64_t)));
+    add_retrieved_part(kIndex, chunk, slot);
+  }
+  slot_count = kRecords;
+
+  return version;
+}
+
+void StateManager::add_retrieved_part(size_t index, const Chunk& chunk,
+                                      size_t slot)
+{
+  next_part_index = max(next_part_index, index + 1);
+  frontier = max(frontier, chunk.end);
+  // Finished parts are kept by former versions.
+  if (chunk.current >= get_part_end(chunk)) {
+    erased_slots.push_back(slot);
+    return;
+  }
+
+  Chunk& part = parts[index];
+  part = chunk;
+  part.slot = slot;
+  initial_parts.push(index);
+}
+
+void StateManager::rebuild_completed_ranges()
+{
+  IntervalSet remaining_ranges;
+  for (const auto& [index, chunk] : parts)
+    remaining_ranges.insert(chunk.current, get_part_end(chunk));
+
+  completed_ranges.clear();
+  for (auto [start, end] : remaining_ranges.get_gaps(0, get_handed_out_end()))
+    completed_ranges.insert(start, end);
+}
+
+void StateManager::clear_parts()
+{
+  parts.clear();
+  initial_parts = queue<size_t>();
+  completed_ranges.clear();
+  next_part_index = 0;
+  frontier = 0;
+  dirty_parts.clear();
+  erased_slots.clear();
+  free_slots.clear();
+  slot_count = 0;
+}
+
+size_t StateManager::get_part_end(const Chunk& chunk) const
+{
+  return min(chunk.end + 1, download_file_size);
+}
+
+size_t StateManager::get_handed_out_end() const
+{
+  // Parts after the first one start one byte after frontier.
+  if (frontier == 0)
+    return 0;
+
+  return min(frontier + 1, download_file_size);
+}
+
+size_t StateManager::allocate_slot()
+{
+  if (free_slots.empty())
+    return slot_count++;
+
+  const size_t kSlot = free_slots.back();
+  free_slots.pop_back();
+  return kSlot;
 }
 
 void StateManager::update(size_t index, size_t recvd_bytes)
 {
-  parts[index].current += recvd_bytes;
-  if (parts[index].current >= parts[index].end) {
-    parts[index].finished = true;
-    parts[index].busy = false;
+  auto part = parts.find(index);
+  if (part == parts.end())
+    return;
+
+  Chunk& chunk = part->second;
+  completed_ranges.insert(chunk.current, chunk.current + recvd_bytes);
+  chunk.current += recvd_bytes;
+  bytes_since_checkpoint += recvd_bytes;
+
+  const bool kChunkFinished = chunk.current >= get_part_end(chunk);
+  if (kChunkFinished) {
+    // Range of part stays in completed ranges, its record is erased on
+    // checkpoint.
+    erased_slots.push_back(chunk.slot);
+    parts.erase(part);
   }
+  else
+    mark_dirty(index);
 
-  total_recvd_bytes += recvd_bytes;
+  if (checkpoint_due(kChunkFinished))
+    checkpoint();
+}
 
-  remove_finished_parts();
+void StateManager::set_checkpoint_policy(const CheckpointPolicy& checkpoint_policy)
+{
+  this->checkpoint_policy = checkpoint_policy;
+}
 
-  store();
+void StateManager::set_data_file(FileIO* data_file)
+{
+  this->data_file = data_file;
 }
 
-void StateManager::store()
+void StateManager::checkpoint()
 {
-  // <index> <start position> <current position> <end position>
-  string download_state = to_string(download_file_size) + "\n";
-  for (auto chunk : parts) {
-    // Chunk index
-    download_state += to_string(chunk.first) + " ";
-    // Start position
-    download_state += to_string(chunk.second.start) + " ";
-    // Current position
-    download_state += to_string(chunk.second.current) + " ";
-    // End position
-    download_state += to_string(chunk.second.end) + "\n";
+  bytes_since_checkpoint = 0;
+  last_checkpoint = steady_clock::now();
+  if (dirty_parts.empty() && erased_slots.empty())
+    return;
+
+  const bool kSync = checkpoint_policy.durability == Durability::SYNC;
+  // Group commit: data first, then state which refers to it.
+  if (kSync && data_file != nullptr)
+    data_file->sync();
+
+  // Slots are reused once data of their parts is stored.
+  for (size_t slot : erased_slots) {
+    erase_record(slot);
+    free_slots.push_back(slot);
+  }
+  erased_slots.clear();
+
+  for (size_t index : dirty_parts) {
+    auto part = parts.find(index);
+    if (part == parts.end())
+      continue;
+    part->second.dirty = false;
+    store_record(index);
   }
-  download_state += "-1 0 0 0\n";
-  state_file->write(download_state.c_str(), download_state.length());
+  dirty_parts.clear();
+
+  if (kSync)
+    state_file->sync();
 }
 
-void StateManager::remove_finished_parts()
+void StateManager::mark_dirty(size_t index)
 {
-  vector<size_t> finished_parts;
+  Chunk& chunk = parts[index];
+  if (!chunk.dirty) {
+    chunk.dirty = true;
+    dirty_parts.push_back(index);
+  }
+}
 
-  for (const auto& part : parts)
-    if (part.second.finished) {
-      finished_parts.push_back(part.first);
-    }
+bool StateManager::checkpoint_due(bool chunk_finished) const
+{
+  if (checkpoint_policy.on_chunk_finish && chunk_finished)
+    return true;
+
+  if (checkpoint_policy.bytes > 0 &&
+      bytes_since_checkpoint >= checkpoint_policy.bytes)
+    return true;
+
+  if (checkpoint_policy.interval_ms > 0) {
+    const auto kElapsed = duration_cast<milliseconds>(steady_clock::now() -
+                                                      last_checkpoint);
+    if (static_cast<size_t>(kElapsed.count()) >= checkpoint_policy.interval_ms)
+      return true;
+  }
 
-  if (finished_parts.size() >= 2) {
-    if (parts[finished_parts[0]].end == parts[finished_parts[1]].start) {
-      parts[finished_parts[0]].end = parts[finished_parts[1]].end;
-      parts[finished_parts[0]].current = parts[finished_parts[1]].current;
-      parts.erase(finished_parts[1]);
-    }
+  return false;
+}
+
+void StateManager::store()
+{
+  state_file->create();
+  store_header();
+  slot_count = 0;
+  free_slots.clear();
+  erased_slots.clear();
+  for (auto& [index, chunk] : parts) {
+    chunk.slot = slot_count++;
+    store_record(index);
   }
 }
 
+void StateManager::store_header()
+{
+  char header[kHeaderSize] = {};
+  const uint64_t kFileSize = download_file_size;
+  const uint64_t kValidatorLength = validator.length();
+  const uint64_t kFrontier = frontier;
+  memcpy(header, kStateMagic, sizeof(kStateMagic));
+  memcpy(header + sizeof(kStateMagic), &kStateVersion, sizeof(kStateVersion));
+  memcpy(header + kFileSizeOffset, &kFileSize, sizeof(kFileSize));
+  memcpy(header + kValidatorOffset, &kValidatorLength, sizeof(kValidatorLength));
+  memcpy(header + kValidatorOffset + sizeof(kValidatorLength), validator.data(),
+         validator.length());
+  memcpy(header + kFrontierOffset, &kFrontier, sizeof(kFrontier));
+  state_file->write(header, kHeaderSize, 0);
+}
+
+void StateManager::store_frontier()
+{
+  const uint64_t kFrontier = frontier;
+  state_file->write(reinterpret_cast<const char*>(&kFrontier),
+                    sizeof(kFrontier), kFrontierOffset);
+}
+
+void StateManager::store_record(size_t index)
+{
+  const Chunk& chunk = parts.at(index);
+  const uint64_t kRecord[] = {index, chunk.start, chunk.current, chunk.end};
+  state_file->write(reinterpret_cast<const char*>(kRecord), kRecordSize,
+                    record_position(chunk.slot));
+}
+
+void StateManager::erase_record(size_t slot)
+{
+  state_file->write(reinterpret_cast<const char*>(&kEmptyRecord),
+                    sizeof(kEmptyRecord), record_position(slot));
+}
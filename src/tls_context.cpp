@@ -0,0 +1,111 @@
+#include "tls_context.h"
+
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+TlsContext::TlsContext()
+  : ctx(SSL_CTX_new(TLS_client_method()))
+  , early_data(false)
+  , handshakes(0)
+  , resumed_handshakes(0)
+  , early_data_accepted(0)
+  , handshake_time_us(0)
+{
+  if (ctx == nullptr)
+    throw runtime_error("Creating SSL context failed.");
+
+  if (SSL_CTX_set_default_verify_paths(ctx) != 1)
+    cerr << "Error setting up trust store" << endl;
+
+  // Sessions are stored by on_new_session() and set on new connections
+  // explicitly, OpenSSL doesn't look up client sessions itself.
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                      SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, &TlsContext::on_new_session);
+}
+
+TlsContext::~TlsContext()
+{
+  for (auto& [key, session] : sessions)
+    if (session != nullptr)
+      SSL_SESSION_free(session);
+  SSL_CTX_free(ctx);
+}
+
+TlsContext& TlsContext::get_instance()
+{
+  static TlsContext instance;
+  return instance;
+}
+
+SSL* TlsContext::new_ssl(const string& host, uint16_t port)
+{
+  SSL* ssl = SSL_new(ctx);
+  if (ssl == nullptr)
+    return nullptr;
+
+  SSL_set_tlsext_host_name(ssl, host.c_str());
+  SSL_set1_host(ssl, host.c_str());
+
+  lock_guard<mutex> lock(sessions_mutex);
+  // Map nodes are never erased, key is used to find host of new sessions.
+  auto session_it = sessions.emplace(host + ":" + to_string(port), nullptr).first;
+  SSL_set_app_data(ssl, &session_it->first);
+  if (session_it->second != nullptr)
+    SSL_set_session(ssl, session_it->second);
+
+  return ssl;
+}
+
+void TlsContext::set_early_data(bool enabled)
+{
+  early_data = enabled;
+}
+
+bool TlsContext::early_data_possible(SSL* ssl) const
+{
+  SSL_SESSION* session = SSL_get_session(ssl);
+
+  return early_data && session != nullptr &&
+         SSL_SESSION_get_max_early_data(session) > 0;
+}
+
+void TlsContext::on_handshake_done(SSL* ssl, chrono::microseconds handshake_time)
+{
+  ++handshakes;
+  handshake_time_us += handshake_time.count();
+  if (SSL_session_reused(ssl))
+    ++resumed_handshakes;
+  if (SSL_get_early_data_status(ssl) == SSL_EARLY_DATA_ACCEPTED)
+    ++early_data_accepted;
+}
+
+TlsContext::Stats TlsContext::get_stats() const
+{
+  Stats stats;
+  stats.handshakes = handshakes;
+  stats.resumed_handshakes = resumed_handshakes;
+  stats.early_data_accepted = early_data_accepted;
+  stats.handshake_time = chrono::microseconds(handshake_time_us.load());
+
+  return stats;
+}
+
+int TlsContext::on_new_session(SSL* ssl, SSL_SESSION* session)
+{
+  const string* key = static_cast<const string*>(SSL_get_app_data(ssl));
+  if (key == nullptr)
+    return 0;
+
+  TlsContext& context = get_instance();
+  lock_guard<mutex> lock(context.sessions_mutex);
+  SSL_SESSION*& stored_session = context.sessions[*key];
+  if (stored_session != nullptr)
+    SSL_SESSION_free(stored_session);
+  stored_session = session;
+
+  // Reference of session is kept.
+  return 1;
+}
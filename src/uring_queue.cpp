@@ -0,0 +1,232 @@
+#include "uring_queue.h"
+
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params)
+{
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags, void* arg, size_t arg_size)
+{
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg,
+                 arg_size);
+}
+
+unsigned* ring_field(void* ring, unsigned offset)
+{
+  return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+}
+
+}   // namespace
+
+UringQueue::UringQueue(unsigned entries)
+  : ring_fd(-1)
+  , params{}
+  , rings(MAP_FAILED)
+  , rings_size(0)
+  , sqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+  , sqe_tail(0)
+  , to_submit(0)
+{
+  ring_fd = io_uring_setup(entries, &params);
+  if (ring_fd < 0)
+    throw runtime_error("UringQueue: io_uring_setup failed.");
+
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+      !(params.features & IORING_FEAT_EXT_ARG)) {
+    release();
+    throw runtime_error("UringQueue: kernel io_uring features are missing.");
+  }
+
+  const size_t kSqRingSize = params.sq_off.array +
+                             params.sq_entries * sizeof(unsigned);
+  const size_t kCqRingSize = params.cq_off.cqes +
+                             params.cq_entries * sizeof(io_uring_cqe);
+  rings_size = max(kSqRingSize, kCqRingSize);
+
+  rings = mmap(nullptr, rings_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  void* sqes_map = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd, IORING_OFF_SQES);
+  sqes = static_cast<io_uring_sqe*>(sqes_map);
+  if (rings == MAP_FAILED || sqes_map == MAP_FAILED) {
+    release();
+    throw runtime_error("UringQueue: mapping rings failed.");
+  }
+
+  sq_head = ring_field(rings, params.sq_off.head);
+  sq_tail = ring_field(rings, params.sq_off.tail);
+  sq_mask = ring_field(rings, params.sq_off.ring_mask);
+  sq_array = ring_field(rings, params.sq_off.array);
+  cq_head = ring_field(rings, params.cq_off.head);
+  cq_tail = ring_field(rings, params.cq_off.tail);
+  cq_mask = ring_field(rings, params.cq_off.ring_mask);
+  cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(rings) +
+                                         params.cq_off.cqes);
+  sqe_tail = *sq_tail;
+}
+
+UringQueue::~UringQueue()
+{
+  release();
+}
+
+bool UringQueue::available()
+{
+  try {
+    UringQueue probe(1);
+  } catch (const runtime_error&) {
+    return false;
+  }
+
+  return true;
+}
+
+bool UringQueue::prepare_recv(int fd, char* buffer, size_t length,
+                              uint64_t user_data)
+{
+  io_uring_sqe* sqe = get_sqe();
+  if (sqe == nullptr)
+    return false;
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer);
+  sqe->len = length;
+  sqe->user_data = user_data;
+
+  return true;
+}
+
+bool UringQueue::prepare_write(int fd, const char* buffer, size_t length,
+                               size_t offset, uint64_t user_data)
+{
+  io_uring_sqe* sqe = get_sqe();
+  if (sqe == nullptr)
+    return false;
+
+  sqe->opcode = IORING_OP_WRITE;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer);
+  sqe->len = length;
+  sqe->off = offset;
+  sqe->user_data = user_data;
+
+  return true;
+}
+
+int UringQueue::submit_and_wait(vector<Completion>& completions,
+                                int timeout_ms)
+{
+  completions.clear();
+  // Completions may already be there, don't block for new ones.
+  const bool kCompleted = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) != *cq_head;
+  if (enter(kCompleted ? 0 : 1, timeout_ms) < 0 &&
+      errno != ETIME && errno != EINTR)
+    return -1;
+
+  reap(completions);
+
+  return completions.size();
+}
+
+bool UringQueue::prepare_poll(int fd, uint64_t user_data)
+{
+  io_uring_sqe* sqe = get_sqe();
+  if (sqe == nullptr)
+    return false;
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll_events = POLLIN;
+  sqe->user_data = user_data;
+
+  return true;
+}
+
+io_uring_sqe* UringQueue::get_sqe()
+{
+  if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >=
+      params.sq_entries) {
+    // Queue is full, hand queued entries over to kernel.
+    enter(0, 0);
+    if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >=
+        params.sq_entries)
+      return nullptr;
+  }
+
+  const unsigned kIndex = sqe_tail & *sq_mask;
+  io_uring_sqe* sqe = &sqes[kIndex];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array[kIndex] = kIndex;
+  ++sqe_tail;
+  ++to_submit;
+
+  return sqe;
+}
+
+int UringQueue::enter(unsigned min_complete, int timeout_ms)
+{
+  __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+
+  unsigned flags = 0;
+  __kernel_timespec timeout{};
+  io_uring_getevents_arg arg{};
+  if (min_complete > 0) {
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1'000'000L;
+    arg.ts = reinterpret_cast<uint64_t>(&timeout);
+    flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+  }
+
+  int submitted = io_uring_enter(ring_fd, to_submit, min_complete, flags,
+                                 flags ? &arg : nullptr,
+                                 flags ? sizeof(arg) : 0);
+  if (submitted > 0)
+    to_submit -= submitted;
+
+  return submitted;
+}
+
+void UringQueue::reap(vector<Completion>& completions)
+{
+  unsigned head = *cq_head;
+  const unsigned kTail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+  for (; head != kTail; ++head) {
+    const io_uring_cqe& cqe = cqes[head & *cq_mask];
+    completions.push_back({cqe.user_data, cqe.res});
+  }
+
+  __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+void UringQueue::release()
+{
+  if (sqes != MAP_FAILED)
+    munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+  if (rings != MAP_FAILED)
+    munmap(rings, rings_size);
+  if (ring_fd >= 0)
+    close(ring_fd);
+
+  sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+  rings = MAP_FAILED;
+  ring_fd = -1;
+}
@@ -0,0 +1,39 @@
+#include "wakeup_event.h"
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+WakeupEvent::WakeupEvent()
+  : descriptor(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  if (descriptor == -1)
+    throw runtime_error("WakeupEvent: creating eventfd failed.");
+}
+
+WakeupEvent::~WakeupEvent()
+{
+  close(descriptor);
+}
+
+void WakeupEvent::notify()
+{
+  const uint64_t kIncrement = 1;
+  if (write(descriptor, &kIncrement, sizeof(kIncrement)) < 0)
+    {/* Counter is already signaled. */}
+}
+
+bool WakeupEvent::reset()
+{
+  uint64_t counter;
+  return read(descriptor, &counter, sizeof(counter)) > 0;
+}
+
+int WakeupEvent::get_descriptor() const noexcept
+{
+  return descriptor;
+}
@@ -0,0 +1,321 @@
+// Counts heap allocations of a complete download against a loopback http
+// server. Global operator new is replaced, so this test has its own binary.
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "node.h"
+#include "file_writer.h"
+#include "units.h"
+
+using namespace std;
+
+namespace {
+
+enum Phase { PROBE, RAMP_UP, STEADY_STATE, TEARDOWN, kPhases };
+
+const char* const kPhaseNames[kPhases] = {"probe", "ramp-up", "steady state",
+                                          "teardown"};
+
+// Phase which allocations are counted in, -1 when not counting.
+atomic<int> current_phase(-1);
+atomic<size_t> phase_allocations[kPhases];
+// Body bytes sent by server in each phase.
+atomic<size_t> phase_bytes[kPhases];
+// Allocations of server threads are not counted.
+thread_local bool server_thread = false;
+
+void count_allocation()
+{
+  const int kPhase = current_phase.load(memory_order_relaxed);
+  if (kPhase >= 0 && !server_thread) {
+    phase_allocations[kPhase].fetch_add(1, memory_order_relaxed);
+  }
+}
+
+}   // namespace
+
+void* operator new(size_t size)
+{
+  count_allocation();
+  void* memory = malloc(size == 0 ? 1 : size);
+  if (memory == nullptr)
+    throw bad_alloc();
+  return memory;
+}
+
+void* operator new(size_t size, align_val_t alignment)
+{
+  count_allocation();
+  void* memory = aligned_alloc(static_cast<size_t>(alignment),
+                               (size + static_cast<size_t>(alignment) - 1) &
+                               ~(static_cast<size_t>(alignment) - 1));
+  if (memory == nullptr)
+    throw bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void* memory, align_val_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void* memory, size_t, align_val_t) noexcept
+{
+  free(memory);
+}
+
+namespace {
+
+// Loopback http server with range and keep-alive support. Switches phase from
+// ramp-up to steady state when all parts are being served and to teardown
+// when whole file is sent.
+class LoopbackServer
+{
+  public:
+    LoopbackServer(size_t file_size, size_t parts)
+      : file_size(file_size)
+      , parts(parts)
+      , responses(0)
+      , sent_bytes(0)
+    {
+      listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bind(listen_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+      listen(listen_socket, 128);
+      socklen_t length = sizeof(address);
+      getsockname(listen_socket, reinterpret_cast<sockaddr*>(&address), &length);
+      port = ntohs(address.sin_port);
+
+      accept_thread = thread([this]() { accept_connections(); });
+    }
+
+    ~LoopbackServer()
+    {
+      shutdown(listen_socket, SHUT_RDWR);
+      close(listen_socket);
+      accept_thread.join();
+      {
+        lock_guard<mutex> lock(sockets_mutex);
+        for (int socket : sockets)
+          shutdown(socket, SHUT_RDWR);
+      }
+      for (thread& connection_thread : connection_threads)
+        connection_thread.join();
+      for (int socket : sockets)
+        close(socket);
+    }
+
+    uint16_t port;
+
+  private:
+    void accept_connections()
+    {
+      server_thread = true;
+      while (true) {
+        int socket = accept(listen_socket, nullptr, nullptr);
+        if (socket == -1)
+          break;
+        lock_guard<mutex> lock(sockets_mutex);
+        sockets.push_back(socket);
+        connection_threads.emplace_back([this, socket]() { serve(socket); });
+      }
+    }
+
+    void serve(int socket)
+    {
+      server_thread = true;
+      string request;
+      char buffer[4096];
+      while (true) {
+        const size_t kHeaderEnd = request.find("\r\n\r\n");
+        if (kHeaderEnd == string::npos) {
+          ssize_t recvd_bytes = recv(socket, buffer, sizeof(buffer), 0);
+          if (recvd_bytes <= 0)
+            return;
+          request.append(buffer, recvd_bytes);
+          continue;
+        }
+
+        size_t start = 0;
+        size_t end = file_size - 1;
+        const size_t kRangePos = request.find("Range: bytes=");
+        const bool kRange = kRangePos != string::npos && kRangePos < kHeaderEnd;
+        if (kRange)
+          sscanf(request.c_str() + kRangePos, "Range: bytes=%zu-%zu", &start, &end);
+        end = min(end, file_size - 1);
+        request.erase(0, kHeaderEnd + 4);
+
+        string header = string(kRange ? "HTTP/1.1 206 Partial Content\r\n"
+                                      : "HTTP/1.1 200 OK\r\n") +
+                        "Content-Length: " + to_string(end - start + 1) + "\r\n";
+        if (kRange)
+          header += "Content-Range: bytes " + to_string(start) + "-" +
+                    to_string(end) + "/" + to_string(file_size) + "\r\n";
+        header += "\r\n";
+        if (!send_all(socket, header.c_str(), header.length()))
+          return;
+
+        // Response of link check is received as the first part.
+        ++responses;
+        if (!send_body(socket, start, end))
+          return;
+      }
+    }
+
+    bool send_body(int socket, size_t start, size_t end)
+    {
+      static const string kBlock(64_KB, 'x');
+      for (size_t position = start; position <= end; position += kBlock.length()) {
+        const size_t kLength = min(kBlock.length(), end - position + 1);
+        if (!send_all(socket, kBlock.c_str(), kLength))
+          return false;
+        int phase = current_phase;
+        if (phase == RAMP_UP && responses >= parts)
+          current_phase = phase = STEADY_STATE;
+        if (phase >= 0)
+          phase_bytes[phase] += kLength;
+        if ((sent_bytes += kLength) >= file_size)
+          current_phase = TEARDOWN;
+      }
+      return true;
+    }
+
+    static bool send_all(int socket, const char* data, size_t length)
+    {
+      while (length > 0) {
+        ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+          return false;
+        data += sent;
+        length -= sent;
+      }
+      return true;
+    }
+
+    const size_t file_size;
+    const size_t parts;
+    atomic<size_t> responses;
+    atomic<size_t> sent_bytes;
+    int listen_socket;
+    thread accept_thread;
+    mutex sockets_mutex;
+    vector<int> sockets;
+    vector<thread> connection_threads;
+};
+
+class CountingNode : public Node
+{
+  public:
+    using Node::Node;
+
+    void on_get_file_info(size_t node_index, size_t file_size,
+                          const string& file_name) override
+    {
+      current_phase = RAMP_UP;
+    }
+
+  protected:
+    void on_data_received(size_t received_bytes, size_t speed) override {}
+};
+
+}   // namespace
+
+class AllocCountTest : public ::testing::Test
+{
+  void TearDown()
+  {
+    unlink(kFileName);
+    unlink((string(".") + kFileName).c_str());
+  }
+
+  protected:
+    static constexpr char kFileName[] = "ALLOC_TEST_FILE";
+    static constexpr size_t kFileSize = 256_MB;
+
+    // Downloads file and prints allocations of each phase.
+    void download(size_t parts)
+    {
+      LoopbackServer server(kFileSize, parts);
+      for (size_t phase = 0; phase < kPhases; ++phase) {
+        phase_allocations[phase] = 0;
+        phase_bytes[phase] = 0;
+      }
+
+      CountingNode node("http://127.0.0.1:" + to_string(server.port) + "/" +
+                        kFileName, "./", parts);
+      current_phase = PROBE;
+      node.start();
+      node.join();
+      current_phase = -1;
+
+      cout << "Allocations with " << parts << " part(s):" << endl;
+      for (size_t phase = 0; phase < kPhases; ++phase) {
+        cout << "  " << setw(12) << left << kPhaseNames[phase] << right
+             << setw(8) << phase_allocations[phase] << " allocations";
+        if (phase_bytes[phase] >= 1_MB)
+          cout << ", " << fixed << setprecision(2)
+               << get_allocations_per_mb(static_cast<Phase>(phase)) << " per MB";
+        cout << endl;
+      }
+    }
+
+    static double get_allocations_per_mb(Phase phase)
+    {
+      return phase_allocations[phase] /
+             (static_cast<double>(phase_bytes[phase]) / 1_MB);
+    }
+};
+
+// Regression gate, receiving path shouldn't allocate. Write buffers are
+// allocated until write-behind queue reaches its memory budget, after that
+// they are reused, so allocations don't grow with received data.
+TEST_F(AllocCountTest, single_part_steady_state_should_allocate_write_buffers_only)
+{
+  // Queued and written buffers together, both may be partially filled.
+  constexpr size_t kWriteBuffers = 2 * FileWriter::kDefaultMemoryBudget /
+                                   FileWriter::kMaxWriteSize;
+  // Growth of queues holding write buffers.
+  constexpr size_t kQueueGrowths = 16;
+  download(1);
+
+  EXPECT_GT(phase_bytes[STEADY_STATE], kFileSize / 2);
+  EXPECT_LE(phase_allocations[STEADY_STATE], kWriteBuffers + kQueueGrowths);
+}
+
+// Each new chunk may allocate, receiving its blocks shouldn't.
+TEST_F(AllocCountTest, multi_part_steady_state_should_allocate_per_chunk_only)
+{
+  constexpr double kMaxAllocationsPerMb = 1;
+  download(4);
+
+  EXPECT_GT(phase_bytes[STEADY_STATE], kFileSize / 2);
+  EXPECT_LE(get_allocations_per_mb(STEADY_STATE), kMaxAllocationsPerMb);
+}
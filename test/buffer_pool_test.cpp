@@ -0,0 +1,76 @@
+#include <thread>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "buffer.h"
+#include "buffer_pool.h"
+
+using namespace std;
+
+TEST(BufferPoolTest, slab_size_should_cover_capacity)
+{
+  EXPECT_EQ(BufferPool::kMinSlabSize, BufferPool::get_slab_size(1));
+  EXPECT_EQ(48_KB, BufferPool::get_slab_size(Buffer::kDefaultCapacity));
+  EXPECT_EQ(BufferPool::kMaxSlabSize,
+            BufferPool::get_slab_size(BufferPool::kMaxSlabSize));
+  EXPECT_EQ(0, BufferPool::get_slab_size(BufferPool::kMaxSlabSize + 1));
+}
+
+TEST(BufferPoolTest, released_slab_should_be_reused_zero_filled)
+{
+  char* data = BufferPool::allocate(10_KB);
+  memset(data, 'x', 10_KB);
+  BufferPool::deallocate(data, 10_KB);
+
+  char* reused_data = BufferPool::allocate(9_KB);
+  EXPECT_EQ(data, reused_data);
+  EXPECT_EQ(9_KB, count(reused_data, reused_data + 9_KB, '\0'));
+  BufferPool::deallocate(reused_data, 9_KB);
+}
+
+TEST(BufferPoolTest, slabs_of_exited_thread_should_be_reused)
+{
+  char* data = nullptr;
+  thread([&data]() {
+    data = BufferPool::allocate(200_KB);
+    BufferPool::deallocate(data, 200_KB);
+  }).join();
+
+  // New thread starts with empty free lists.
+  char* reused_data = nullptr;
+  thread([&reused_data]() {
+    reused_data = BufferPool::allocate(200_KB);
+    BufferPool::deallocate(reused_data, 200_KB);
+  }).join();
+  EXPECT_EQ(data, reused_data);
+}
+
+TEST(BufferPoolTest, steady_state_buffers_should_not_allocate_from_heap)
+{
+  {
+    Buffer warm_up;
+    Buffer warm_up_copy(warm_up);
+  }
+  const BufferPool::Stats kStats = BufferPool::get_stats();
+  for (int i = 0; i < 100; ++i) {
+    Buffer buffer;
+    Buffer copy(buffer);
+  }
+
+  const BufferPool::Stats kNewStats = BufferPool::get_stats();
+  EXPECT_EQ(kStats.heap_allocations, kNewStats.heap_allocations);
+  EXPECT_EQ(kStats.reused_slabs + 200, kNewStats.reused_slabs);
+}
+
+TEST(BufferPoolTest, extending_within_slab_should_keep_storage)
+{
+  Buffer buffer(40_KB);
+  buffer << "abc";
+  const char* data = buffer;
+  buffer.extend(48_KB);
+
+  EXPECT_EQ(data, static_cast<char*>(buffer));
+  EXPECT_EQ(48_KB, buffer.total_capacity());
+  EXPECT_EQ(0, strncmp("abc", buffer, 3));
+}
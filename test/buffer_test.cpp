@@ -261,7 +261,8 @@ TYPED_TEST(BufferInsertionOperatorTest, should_insert_data_and_update_length)
 
   Buffer test_buffer;
   unique_ptr<char[]> random_data;
-  random_data = get_random_buffer(this->rand_len, 0x21, 0x7e); // Printable characters
+  random_data = get_random_buffer(this->rand_len + 1, 0x21, 0x7e); // Printable characters
+  random_data[this->rand_len] = '\0';
 
   EXPECT_EQ(0, test_buffer.length());
   EXPECT_STRNE(random_data.get(), test_buffer);
@@ -283,7 +284,8 @@ TYPED_TEST(BufferInsertionOperatorTest, should_append_the_end_of_contents)
 
   // Create random data
   unique_ptr<char[]> random_data;
-  random_data = get_random_buffer(this->rand_len, 0x20, 0x7e); // Printable chars
+  random_data = get_random_buffer(this->rand_len + 1, 0x20, 0x7e); // Printable chars
+  random_data[this->rand_len] = '\0';
   size_t expected_contents_len = strlen(random_data.get()) + this->buffer.length();
   const size_t initial_buffer_len = this->buffer.length();
 
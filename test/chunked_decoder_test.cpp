@@ -0,0 +1,74 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "chunked_decoder.h"
+
+using namespace std;
+
+namespace {
+
+const string kEncoded = "4\r\nWiki\r\n"
+                        "6;name=value\r\npedia \r\n"
+                        "E\r\nin \r\n\r\nchunks.\r\n"
+                        "0\r\n"
+                        "Expires: never\r\n"
+                        "\r\n";
+const string kDecoded = "Wikipedia in \r\n\r\nchunks.";
+
+}   // namespace
+
+class ChunkedDecoderTest : public ::testing::Test
+{
+  protected:
+    string decode(string data)
+    {
+      const size_t kLength = decoder.decode(&data[0], data.length());
+      return data.substr(0, kLength);
+    }
+
+    ChunkedDecoder decoder;
+};
+
+TEST_F(ChunkedDecoderTest, should_decode_whole_body)
+{
+  EXPECT_EQ(kDecoded, decode(kEncoded));
+  EXPECT_TRUE(decoder.is_finished());
+}
+
+TEST_F(ChunkedDecoderTest, should_decode_body_split_at_any_byte)
+{
+  for (size_t split = 1; split < kEncoded.length(); ++split) {
+    decoder.reset();
+    string decoded = decode(kEncoded.substr(0, split));
+    EXPECT_FALSE(decoder.is_finished()) << "split: " << split;
+    decoded += decode(kEncoded.substr(split));
+
+    EXPECT_EQ(kDecoded, decoded) << "split: " << split;
+    EXPECT_TRUE(decoder.is_finished()) << "split: " << split;
+  }
+}
+
+TEST_F(ChunkedDecoderTest, bytes_after_last_chunk_should_be_ignored)
+{
+  EXPECT_EQ("abc", decode("3\r\nabc\r\n0\r\n\r\nHTTP/1.1 200 OK"));
+  EXPECT_TRUE(decoder.is_finished());
+}
+
+TEST_F(ChunkedDecoderTest, invalid_framing_should_be_rejected)
+{
+  decode("x\r\n");
+  EXPECT_TRUE(decoder.has_error());
+
+  decoder.reset();
+  decode("\r\n");
+  EXPECT_TRUE(decoder.has_error());
+
+  decoder.reset();
+  decode("3\r\nabcd\r\n");
+  EXPECT_TRUE(decoder.has_error());
+
+  decoder.reset();
+  decode("fffffffffffffffff\r\n");
+  EXPECT_TRUE(decoder.has_error());
+}
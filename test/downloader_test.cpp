@@ -0,0 +1,352 @@
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <functional>
+
+#include <gtest/gtest.h>
+
+#include "node.h"
+#include "units.h"
+
+using namespace std;
+
+namespace {
+
+// Bytes of test file, versions of file start with different letters.
+string file_range(size_t start, size_t end, char first_letter = 'a')
+{
+  string range;
+  range.reserve(end - start + 1);
+  for (size_t position = start; position <= end; ++position)
+    range += first_letter + position % 26;
+  return range;
+}
+
+// Loopback http server, each request is answered by responder and its
+// connection is closed.
+class LoopbackServer
+{
+  public:
+    // Returns response to request of range [start, end].
+    using Responder = function<string(const string& request, size_t start,
+                                      size_t end)>;
+
+    // Answers request of range [start, end] on socket itself.
+    using Handler = function<void(int socket, const string& request,
+                                  size_t start, size_t end)>;
+
+    LoopbackServer(size_t file_size, Responder responder)
+      : LoopbackServer(file_size, Handler(
+            [responder](int socket, const string& request, size_t start,
+                        size_t end) {
+              send_all(socket, responder(request, start, end));
+            }))
+    {
+    }
+
+    LoopbackServer(size_t file_size, Handler handler)
+      : file_size(file_size)
+      , handler(handler)
+    {
+      listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bind(listen_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+      listen(listen_socket, 128);
+      socklen_t length = sizeof(address);
+      getsockname(listen_socket, reinterpret_cast<sockaddr*>(&address), &length);
+      port = ntohs(address.sin_port);
+
+      accept_thread = thread([this]() { accept_connections(); });
+    }
+
+    ~LoopbackServer()
+    {
+      shutdown(listen_socket, SHUT_RDWR);
+      close(listen_socket);
+      accept_thread.join();
+      for (thread& connection_thread : connection_threads)
+        connection_thread.join();
+    }
+
+    // Partial response of range, Content-Range may claim another start.
+    static string partial_response(size_t start, size_t end, size_t file_size,
+                                   size_t claimed_start, const string& etag = "",
+                                   char first_letter = 'a')
+    {
+      const size_t kClaimedEnd = claimed_start + end - start;
+      return "HTTP/1.1 206 Partial Content\r\n"
+             "Connection: close\r\n" + get_etag_header(etag) +
+             "Content-Length: " + to_string(end - start + 1) + "\r\n"
+             "Content-Range: bytes " + to_string(claimed_start) + "-" +
+             to_string(kClaimedEnd) + "/" + to_string(file_size) + "\r\n\r\n" +
+             file_range(start, end, first_letter);
+    }
+
+    // Response of unknown length, body is coded by given chunks.
+    static string chunked_response(const string& chunks)
+    {
+      return "HTTP/1.1 200 OK\r\n"
+             "Connection: close\r\n"
+             "Transfer-Encoding: chunked\r\n\r\n" + chunks;
+    }
+
+    static void send_all(int socket, const string& data)
+    {
+      const char* remaining = data.c_str();
+      size_t length = data.length();
+      while (length > 0) {
+        ssize_t sent = send(socket, remaining, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+          break;
+        remaining += sent;
+        length -= sent;
+      }
+    }
+
+    static string whole_file_response(size_t file_size, const string& etag,
+                                      char first_letter)
+    {
+      return "HTTP/1.1 200 OK\r\n"
+             "Connection: close\r\n" + get_etag_header(etag) +
+             "Content-Length: " + to_string(file_size) + "\r\n\r\n" +
+             file_range(0, file_size - 1, first_letter);
+    }
+
+    uint16_t port;
+
+  private:
+    static string get_etag_header(const string& etag)
+    {
+      return etag.empty() ? "" : "ETag: " + etag + "\r\n";
+    }
+
+    void accept_connections()
+    {
+      while (true) {
+        int socket = accept(listen_socket, nullptr, nullptr);
+        if (socket == -1)
+          break;
+        lock_guard<mutex> lock(threads_mutex);
+        connection_threads.emplace_back([this, socket]() { serve(socket); });
+      }
+    }
+
+    void serve(int socket)
+    {
+      string request;
+      char buffer[4096];
+      while (request.find("\r\n\r\n") == string::npos) {
+        ssize_t recvd_bytes = recv(socket, buffer, sizeof(buffer), 0);
+        if (recvd_bytes <= 0) {
+          close(socket);
+          return;
+        }
+        request.append(buffer, recvd_bytes);
+      }
+
+      size_t start = 0;
+      size_t end = file_size - 1;
+      const size_t kRangePos = request.find("Range: bytes=");
+      if (kRangePos != string::npos)
+        sscanf(request.c_str() + kRangePos, "Range: bytes=%zu-%zu", &start, &end);
+      end = min(end, file_size - 1);
+
+      handler(socket, request, start, end);
+      close(socket);
+    }
+
+    const size_t file_size;
+    Handler handler;
+    int listen_socket;
+    thread accept_thread;
+    mutex threads_mutex;
+    vector<thread> connection_threads;
+};
+
+class TestNode : public Node
+{
+  public:
+    using Node::Node;
+
+  protected:
+    void on_data_received(size_t received_bytes, size_t speed) override {}
+};
+
+}   // namespace
+
+class DownloaderTest : public ::testing::Test
+{
+  void TearDown()
+  {
+    unlink(kFileName);
+    unlink((string(".") + kFileName + ".stat").c_str());
+  }
+
+  protected:
+    static constexpr char kFileName[] = "DOWNLOADER_TEST_FILE";
+    static constexpr size_t kFileSize = 4_MB;
+
+    OperationStatus download(const LoopbackServer& server, size_t parts,
+                             IoEngine io_engine = IoEngine::EPOLL)
+    {
+      TestNode node("http://127.0.0.1:" + to_string(server.port) + "/" +
+                    kFileName, "./", parts);
+      node.set_io_engine(io_engine);
+      node.start();
+      node.join();
+
+      return node.get_status();
+    }
+
+    static string get_file_contents()
+    {
+      ifstream file(kFileName, ios::binary);
+      stringstream contents;
+      contents << file.rdbuf();
+      return contents.str();
+    }
+};
+
+TEST_F(DownloaderTest, mismatched_range_should_be_requested_again)
+{
+  atomic<size_t> mismatched_responses(0);
+  LoopbackServer server(kFileSize, [&](const string&, size_t start, size_t end) {
+    // First response of a later part starts one byte after requested range.
+    const bool kMismatch = start > 0 && mismatched_responses++ == 0;
+    return LoopbackServer::partial_response(start, end, kFileSize,
+                                            kMismatch ? start + 1 : start);
+  });
+
+  EXPECT_EQ(OperationStatus::FINISHED, download(server, 2));
+  EXPECT_GT(mismatched_responses.load(), 0);
+  EXPECT_TRUE(get_file_contents() == file_range(0, kFileSize - 1));
+}
+
+TEST_F(DownloaderTest, mismatched_range_should_stop_download)
+{
+  LoopbackServer server(kFileSize, [&](const string&, size_t start, size_t end) {
+    return LoopbackServer::partial_response(start, end, kFileSize,
+                                            start > 0 ? start + 1 : start);
+  });
+
+  EXPECT_EQ(OperationStatus::RESPONSE_ERROR, download(server, 2));
+}
+
+TEST_F(DownloaderTest, stopped_io_uring_download_should_release_buffers)
+{
+  // Large file, so first part is still receiving when download stops.
+  constexpr size_t kLargeFileSize = 64_MB;
+  LoopbackServer server(kLargeFileSize, [&](const string&, size_t start,
+                                            size_t end) {
+    return LoopbackServer::partial_response(start, end, kLargeFileSize,
+                                            start > 0 ? start + 1 : start);
+  });
+
+  EXPECT_EQ(OperationStatus::RESPONSE_ERROR,
+            download(server, 2, IoEngine::IO_URING));
+}
+
+TEST_F(DownloaderTest, changed_file_should_be_downloaded_again)
+{
+  atomic<bool> changed(false);
+  LoopbackServer server(kFileSize, [&](const string& request, size_t start,
+                                       size_t end) {
+    const string kETag = changed ? "\"v2\"" : "\"v1\"";
+    const char kFirstLetter = changed ? 'A' : 'a';
+    if (request.find("If-Range: ") != string::npos &&
+        request.find("If-Range: " + kETag) == string::npos)
+      return LoopbackServer::whole_file_response(kFileSize, kETag, kFirstLetter);
+
+    // File changes after link check of first download.
+    const string kResponse = LoopbackServer::partial_response(
+        start, end, kFileSize, start, kETag, kFirstLetter);
+    changed = true;
+    return kResponse;
+  });
+
+  EXPECT_EQ(OperationStatus::FINISHED, download(server, 2));
+  EXPECT_TRUE(get_file_contents() == file_range(0, kFileSize - 1, 'A'));
+}
+
+TEST_F(DownloaderTest, truncated_stream_should_stop_download)
+{
+  LoopbackServer server(kFileSize, [&](const string&, size_t, size_t) {
+    return LoopbackServer::chunked_response("4\r\nbody\r\n8\r\nbo");
+  });
+
+  EXPECT_EQ(OperationStatus::SOCKET_RECV_ERROR, download(server, 1));
+}
+
+TEST_F(DownloaderTest, malformed_chunk_size_should_stop_download)
+{
+  LoopbackServer server(kFileSize, [&](const string&, size_t, size_t) {
+    return LoopbackServer::chunked_response("4\r\nbody\r\nzz\r\nbody\r\n0\r\n\r\n");
+  });
+
+  EXPECT_EQ(OperationStatus::RESPONSE_ERROR, download(server, 1));
+}
+
+TEST_F(DownloaderTest, chunked_stream_should_be_received)
+{
+  LoopbackServer server(kFileSize, [&](const string&, size_t, size_t) {
+    return LoopbackServer::chunked_response("4\r\nbody\r\n0\r\n\r\n");
+  });
+
+  EXPECT_EQ(OperationStatus::FINISHED, download(server, 1));
+  EXPECT_EQ("body", get_file_contents());
+}
+
+TEST_F(DownloaderTest, io_uring_download_should_be_received)
+{
+  LoopbackServer server(kFileSize, [&](const string&, size_t start, size_t end) {
+    return LoopbackServer::partial_response(start, end, kFileSize, start);
+  });
+
+  EXPECT_EQ(OperationStatus::FINISHED, download(server, 2, IoEngine::IO_URING));
+  EXPECT_TRUE(get_file_contents() == file_range(0, kFileSize - 1));
+}
+
+TEST_F(DownloaderTest, link_check_connection_should_not_be_reused_before_its_end)
+{
+  // Size of first part, [0, 1_MB], link check response pauses at its end.
+  constexpr size_t kPartSize = 1_MB + 1;
+  atomic<bool> reused(false);
+  LoopbackServer server(kFileSize, LoopbackServer::Handler(
+      [&](int socket, const string& request, size_t start, size_t end) {
+        const string kResponse = LoopbackServer::partial_response(
+            start, end, kFileSize, start);
+        if (request.find("Range: bytes=0-\r\n") == string::npos) {
+          LoopbackServer::send_all(socket, kResponse);
+          return;
+        }
+        // Persistent connection, so it's reused once its response ends.
+        string response = kResponse;
+        response.replace(response.find("close"), 5, "keep-alive");
+        const size_t kPause = response.find("\r\n\r\n") + 4 + kPartSize;
+        LoopbackServer::send_all(socket, response.substr(0, kPause));
+        // Next request is sent on socket if it's released too early, a
+        // closed socket is fine.
+        pollfd poll_fd{socket, POLLIN, 0};
+        char byte;
+        reused = poll(&poll_fd, 1, 200) > 0 &&
+                 recv(socket, &byte, 1, MSG_PEEK) > 0;
+        LoopbackServer::send_all(socket, response.substr(kPause));
+      }));
+
+  EXPECT_EQ(OperationStatus::FINISHED, download(server, 2));
+  EXPECT_FALSE(reused);
+  EXPECT_TRUE(get_file_contents() == file_range(0, kFileSize - 1));
+}
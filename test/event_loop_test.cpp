@@ -0,0 +1,84 @@
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "epoll_event_loop.h"
+
+using namespace std;
+
+class EpollEventLoopTest : public ::testing::Test
+{
+  void SetUp()
+  {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets_0));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets_1));
+  }
+
+  void TearDown()
+  {
+    for (int fd : {sockets_0[0], sockets_0[1], sockets_1[0], sockets_1[1]})
+      close(fd);
+  }
+
+  protected:
+    static constexpr size_t kKey0 = 7;
+    static constexpr size_t kKey1 = 70000;
+    int sockets_0[2];
+    int sockets_1[2];
+    EpollEventLoop event_loop;
+    vector<size_t> ready_keys;
+};
+
+TEST_F(EpollEventLoopTest, wait_should_timeout_if_nothing_is_readable)
+{
+  ASSERT_TRUE(event_loop.add(sockets_0[0], kKey0));
+  EXPECT_EQ(0, event_loop.wait(ready_keys, 10));
+  EXPECT_TRUE(ready_keys.empty());
+}
+
+TEST_F(EpollEventLoopTest, only_readable_descriptors_should_be_reported)
+{
+  ASSERT_TRUE(event_loop.add(sockets_0[0], kKey0));
+  ASSERT_TRUE(event_loop.add(sockets_1[0], kKey1));
+  ASSERT_EQ(1, write(sockets_1[1], "x", 1));
+
+  EXPECT_EQ(1, event_loop.wait(ready_keys, 100));
+  ASSERT_EQ(1, ready_keys.size());
+  EXPECT_EQ(kKey1, ready_keys[0]);
+}
+
+TEST_F(EpollEventLoopTest, readiness_should_be_reported_once_per_edge)
+{
+  ASSERT_TRUE(event_loop.add(sockets_0[0], kKey0));
+  ASSERT_EQ(1, write(sockets_0[1], "x", 1));
+
+  EXPECT_EQ(1, event_loop.wait(ready_keys, 100));
+  // Not drained, but no new data arrived.
+  EXPECT_EQ(0, event_loop.wait(ready_keys, 10));
+
+  ASSERT_EQ(1, write(sockets_0[1], "y", 1));
+  EXPECT_EQ(1, event_loop.wait(ready_keys, 100));
+}
+
+TEST_F(EpollEventLoopTest, removed_descriptor_should_not_be_reported)
+{
+  ASSERT_TRUE(event_loop.add(sockets_0[0], kKey0));
+  ASSERT_TRUE(event_loop.remove(sockets_0[0]));
+  ASSERT_EQ(1, write(sockets_0[1], "x", 1));
+
+  EXPECT_EQ(0, event_loop.wait(ready_keys, 10));
+  EXPECT_FALSE(event_loop.remove(sockets_0[0]));
+}
+
+TEST_F(EpollEventLoopTest, writable_descriptor_should_be_reported_if_watched)
+{
+  ASSERT_TRUE(event_loop.add(sockets_0[0], kKey0, true));
+  ASSERT_TRUE(event_loop.add(sockets_1[0], kKey1));
+
+  EXPECT_EQ(1, event_loop.wait(ready_keys, 100));
+  ASSERT_EQ(1, ready_keys.size());
+  EXPECT_EQ(kKey0, ready_keys[0]);
+}
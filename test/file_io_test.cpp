@@ -1,8 +1,10 @@
 #include <memory>
 #include <string>
+#include <vector>
 #include <exception>
 #include <gtest/gtest.h>
 
+#include "units.h"
 #include "file_io.h"
 #include "test_utils.h"
 
@@ -141,3 +143,59 @@ TEST_F(FileIOTest, dir_path_should_identified_as_dir_t)
   FileIO file_io(TEST_DIR_PATH);
   EXPECT_EQ(PathType::DIRECTORY_T, file_io.check_path_type());
 }
+
+TEST_F(FileIOTest, created_file_should_be_filled_with_zero)
+{
+  static constexpr size_t kFileLength = 3 * Buffer::kDefaultCapacity + 5;
+  writer.create(kFileLength);
+
+  reader.open();
+  EXPECT_EQ(string(kFileLength, '\0'), reader.get_file_contents());
+}
+
+TEST_F(FileIOTest, descriptor_should_be_available_only_for_open_file)
+{
+  EXPECT_EQ(-1, reader.get_descriptor());
+  reader.open();
+  EXPECT_NE(-1, reader.get_descriptor());
+  EXPECT_NE(-1, writer.get_descriptor());
+}
+
+TEST_F(FileIOTest, data_ranges_should_skip_unwritten_preallocated_space)
+{
+  constexpr size_t kFileLength = 8_MB;
+  const string kData(100000, 'x');
+  writer.create(kFileLength);
+  writer.write(kData.c_str(), kData.length(), 0);
+  writer.write(kData.c_str(), kData.length(), 3_MB);
+
+  vector<pair<size_t, size_t>> ranges = writer.get_data_ranges();
+  const size_t kBlockSize = writer.get_block_size();
+  EXPECT_EQ(kFileLength, writer.get_size());
+  // File system without hole reporting has one range of whole file.
+  if (ranges.size() == 1 && ranges.front().second == kFileLength)
+    GTEST_SKIP() << "File system doesn't report holes.";
+
+  ASSERT_EQ(2, ranges.size());
+  EXPECT_EQ(0, ranges[0].first);
+  EXPECT_GE(ranges[0].second, kData.length());
+  EXPECT_LT(ranges[0].second, kData.length() + kBlockSize);
+  EXPECT_LE(ranges[1].first, 3_MB);
+  EXPECT_GE(ranges[1].second, 3_MB + kData.length());
+}
+
+TEST_F(FileIOTest, sparse_file_should_be_written_beyond_terabytes)
+{
+  // Output files of multi-terabyte downloads are sparse until received.
+  constexpr size_t kPosition = 3_TB;
+  const string kData(100000, 'x');
+  writer.open();
+  if (!writer.write(kData.c_str(), kData.length(), kPosition))
+    GTEST_SKIP() << "File system doesn't support large files.";
+
+  EXPECT_EQ(kPosition + kData.length(), writer.get_size());
+  vector<pair<size_t, size_t>> ranges = writer.get_data_ranges();
+  ASSERT_FALSE(ranges.empty());
+  EXPECT_LE(ranges.back().first, kPosition);
+  EXPECT_EQ(kPosition + kData.length(), ranges.back().second);
+}
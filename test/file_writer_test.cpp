@@ -0,0 +1,160 @@
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "test_utils.h"
+#include "file_writer.h"
+
+using namespace std;
+
+namespace {
+
+// Output file which fails every write, e.g. disk is full.
+class FailingFileIO : public FileIOMock
+{
+  public:
+    bool write(const char* buffer, size_t length, size_t position=0) override
+    {
+      return false;
+    }
+};
+
+// Output file which fails writes at one position.
+class FailingAtFileIO : public FileIOMock
+{
+  public:
+    explicit FailingAtFileIO(size_t failing_position)
+      : failing_position(failing_position)
+    {
+    }
+
+    bool write(const char* buffer, size_t length, size_t position=0) override
+    {
+      if (position == failing_position)
+        return false;
+      return FileIOMock::write(buffer, length, position);
+    }
+
+  private:
+    const size_t failing_position;
+};
+
+}   // namespace
+
+class FileWriterTest : public ::testing::Test
+{
+  void SetUp()
+  {
+    file_io.create(kFileSize);
+    memset(file_io.get_file_buffer(), '-', kFileSize);
+  }
+
+  protected:
+    static constexpr size_t kFileSize = 1000;
+    FileIOMock file_io;
+    vector<FileWriter::WrittenPart> written_parts;
+};
+
+TEST_F(FileWriterTest, queued_data_should_be_written_after_stop)
+{
+  FileWriter file_writer(&file_io);
+  file_writer.enqueue(0, "abc", 3, 10);
+  file_writer.enqueue(1, "xyz", 3, 500);
+  file_writer.start();
+  file_writer.stop();
+  file_writer.join();
+
+  EXPECT_EQ(0, strncmp("abc", file_io.get_file_buffer() + 10, 3));
+  EXPECT_EQ(0, strncmp("xyz", file_io.get_file_buffer() + 500, 3));
+  EXPECT_EQ(0, file_writer.get_pending_bytes());
+  EXPECT_EQ(0, file_writer.get_queue_depth());
+}
+
+TEST_F(FileWriterTest, adjacent_writes_of_one_part_should_be_coalesced)
+{
+  FileWriter file_writer(&file_io);
+  file_writer.enqueue(0, "abc", 3, 10);
+  file_writer.enqueue(1, "xyz", 3, 500);
+  file_writer.enqueue(0, "def", 3, 13);
+  // Not adjacent
+  file_writer.enqueue(0, "ghi", 3, 20);
+  EXPECT_EQ(3, file_writer.get_queue_depth());
+  EXPECT_EQ(12, file_writer.get_pending_bytes());
+
+  file_writer.start();
+  file_writer.stop();
+  file_writer.join();
+
+  EXPECT_EQ(0, strncmp("abcdef----ghi", file_io.get_file_buffer() + 10, 13));
+  file_writer.collect_written(written_parts);
+  ASSERT_EQ(3, written_parts.size());
+  EXPECT_EQ(FileWriter::WrittenPart(0, 6), written_parts[0]);
+  EXPECT_EQ(FileWriter::WrittenPart(1, 3), written_parts[1]);
+  EXPECT_EQ(FileWriter::WrittenPart(0, 3), written_parts[2]);
+
+  file_writer.collect_written(written_parts);
+  EXPECT_TRUE(written_parts.empty());
+}
+
+TEST_F(FileWriterTest, writes_should_not_be_coalesced_beyond_max_write_size)
+{
+  static constexpr size_t kLength = FileWriter::kMaxWriteSize / 2 + 1;
+  FileIOMock large_file_io;
+  large_file_io.create(2 * kLength);
+  const string kData(kLength, 'x');
+
+  FileWriter file_writer(&large_file_io);
+  file_writer.enqueue(0, kData.c_str(), kLength, 0);
+  file_writer.enqueue(0, kData.c_str(), kLength, kLength);
+  EXPECT_EQ(2, file_writer.get_queue_depth());
+}
+
+TEST_F(FileWriterTest, wait_for_budget_should_return_when_data_is_written)
+{
+  static constexpr size_t kBudget = 4;
+  FileWriter file_writer(&file_io, kBudget);
+  file_writer.enqueue(0, "abcdef", 6, 0);
+  EXPECT_GT(file_writer.get_pending_bytes(), kBudget);
+
+  file_writer.start();
+  file_writer.wait_for_budget();
+  EXPECT_LE(file_writer.get_pending_bytes(), kBudget);
+  file_writer.stop();
+  file_writer.join();
+}
+
+TEST_F(FileWriterTest, failed_writes_should_not_be_reported_as_written)
+{
+  FailingFileIO failing_file_io;
+  FileWriter file_writer(&failing_file_io);
+  file_writer.enqueue(0, "abc", 3, 10);
+  file_writer.start();
+  file_writer.stop();
+  file_writer.join();
+
+  EXPECT_TRUE(file_writer.has_failed());
+  EXPECT_EQ(0, file_writer.get_pending_bytes());
+  file_writer.collect_written(written_parts);
+  EXPECT_TRUE(written_parts.empty());
+}
+
+TEST_F(FileWriterTest, writes_after_failed_write_of_part_should_not_be_reported)
+{
+  FailingAtFileIO failing_file_io(10);
+  failing_file_io.create(kFileSize);
+  FileWriter file_writer(&failing_file_io);
+  file_writer.enqueue(0, "abc", 3, 10);
+  file_writer.enqueue(1, "xyz", 3, 500);
+  // Not adjacent, written separately after the hole.
+  file_writer.enqueue(0, "ghi", 3, 20);
+  file_writer.start();
+  file_writer.stop();
+  file_writer.join();
+
+  EXPECT_TRUE(file_writer.has_failed());
+  file_writer.collect_written(written_parts);
+  ASSERT_EQ(1, written_parts.size());
+  EXPECT_EQ(FileWriter::WrittenPart(1, 3), written_parts[0]);
+}
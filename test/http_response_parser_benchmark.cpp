@@ -0,0 +1,63 @@
+// Compares parsing a response header by HttpResponseParser with the former
+// PatternFinder searches. Timings depend on build type and machine load, so
+// this is a separate binary and not a part of unit tests.
+
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+
+#include "units.h"
+#include "buffer.h"
+#include "pattern_finder.h"
+#include "http_response_parser.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr int kRounds = 20000;
+
+const string kHeader = "HTTP/1.1 206 Partial Content\r\n"
+                       "Server: test\r\n"
+                       "Content-Length: 1000\r\n"
+                       "Content-Range: bytes 1000-1999/5000\r\n"
+                       "accept-ranges:  Bytes \r\n"
+                       "ETag: W/\"5e-1a\"\r\n"
+                       "Last-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+                       "\r\n";
+
+}   // namespace
+
+int main()
+{
+  // Header followed by a typical first block of body.
+  Buffer response(kHeader + string(16_KB, 'x'));
+
+  PatternFinder pattern_finder;
+  size_t checksum = 0;
+  auto start = steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    checksum += pattern_finder.find_http_header_delimiter(response);
+    checksum += pattern_finder.find_file_length(response);
+    checksum += pattern_finder.find_redirection(response).first;
+  }
+  const nanoseconds kPatternFinderTime = (steady_clock::now() - start) / kRounds;
+
+  HttpResponseParser parser;
+  start = steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    parser.reset();
+    checksum += parser.parse(response, response.length());
+    checksum += parser.get_content_length();
+  }
+  const nanoseconds kParserTime = (steady_clock::now() - start) / kRounds;
+
+  // Checksum keeps the loops from being optimized away.
+  cout << "PatternFinder: " << kPatternFinderTime.count() << " ns, "
+       << "HttpResponseParser: " << kParserTime.count() << " ns per header"
+       << " (checksum " << checksum << ")" << endl;
+
+  return kParserTime < kPatternFinderTime ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,189 @@
+#include <string>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "buffer.h"
+#include "test_utils.h"
+#include "http_response_parser.h"
+
+using namespace std;
+
+namespace {
+
+const string kHeader = "HTTP/1.1 206 Partial Content\r\n"
+                       "Server: test\r\n"
+                       "Content-Length: 1000\r\n"
+                       "Content-Range: bytes 1000-1999/5000\r\n"
+                       "accept-ranges:  Bytes \r\n"
+                       "ETag: W/\"5e-1a\"\r\n"
+                       "Last-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+                       "\r\n";
+const string kBody = "body";
+
+}   // namespace
+
+class HttpResponseParserTest : public ::testing::Test
+{
+  protected:
+    size_t parse(const string& data)
+    {
+      return parser.parse(data.c_str(), data.length());
+    }
+
+    void expect_fields()
+    {
+      ASSERT_TRUE(parser.is_complete());
+      EXPECT_EQ(206, parser.get_status_code());
+      EXPECT_EQ(1000, parser.get_content_length());
+      ASSERT_TRUE(parser.has_content_range());
+      EXPECT_EQ(1000, parser.get_content_range().start);
+      EXPECT_EQ(1999, parser.get_content_range().end);
+      EXPECT_EQ(5000, parser.get_content_range().total);
+      EXPECT_TRUE(parser.accepts_ranges());
+      EXPECT_EQ("W/\"5e-1a\"", parser.get_etag());
+      EXPECT_EQ("Wed, 21 Oct 2015 07:28:00 GMT", parser.get_last_modified());
+      EXPECT_FALSE(parser.is_chunked());
+      EXPECT_TRUE(parser.is_persistent());
+      EXPECT_TRUE(parser.get_location().empty());
+    }
+
+    HttpResponseParser parser;
+};
+
+TEST_F(HttpResponseParserTest, should_parse_header_of_one_block)
+{
+  EXPECT_EQ(kHeader.length(), parse(kHeader + kBody));
+  expect_fields();
+}
+
+TEST_F(HttpResponseParserTest, should_parse_header_split_at_any_byte)
+{
+  const string kResponse = kHeader + kBody;
+  for (size_t split = 1; split < kHeader.length(); ++split) {
+    parser.reset();
+    EXPECT_EQ(split, parse(kResponse.substr(0, split)));
+    ASSERT_FALSE(parser.is_complete()) << "split: " << split;
+    EXPECT_EQ(kHeader.length() - split, parse(kResponse.substr(split)))
+      << "split: " << split;
+    expect_fields();
+  }
+}
+
+TEST_F(HttpResponseParserTest, should_parse_header_received_byte_by_byte)
+{
+  for (char byte : kHeader)
+    parse(string(1, byte));
+
+  expect_fields();
+}
+
+TEST_F(HttpResponseParserTest, should_parse_redirection_and_chunked_encoding)
+{
+  parse("HTTP/1.1 302 Found\r\n"
+        "Location: http://example.com/file.bin\r\n"
+        "Transfer-Encoding: gzip, Chunked\r\n\r\n");
+
+  ASSERT_TRUE(parser.is_complete());
+  EXPECT_EQ(302, parser.get_status_code());
+  EXPECT_EQ("http://example.com/file.bin", parser.get_location());
+  EXPECT_TRUE(parser.is_chunked());
+  EXPECT_EQ(HttpResponseParser::kUnknownLength, parser.get_content_length());
+  EXPECT_FALSE(parser.has_content_range());
+}
+
+TEST_F(HttpResponseParserTest, unsatisfiable_range_should_be_unknown)
+{
+  parse("HTTP/1.1 416 Range Not Satisfiable\r\n"
+        "Content-Range: bytes */5000\r\n\r\n");
+
+  ASSERT_TRUE(parser.has_content_range());
+  EXPECT_EQ(HttpResponseParser::kUnknownLength, parser.get_content_range().start);
+  EXPECT_EQ(5000, parser.get_content_range().total);
+}
+
+TEST_F(HttpResponseParserTest, connection_header_should_set_persistence)
+{
+  parse("HTTP/1.1 200 OK\r\nConnection: Close\r\n\r\n");
+  EXPECT_FALSE(parser.is_persistent());
+
+  parser.reset();
+  parse("HTTP/1.0 200 OK\r\n\r\n");
+  EXPECT_FALSE(parser.is_persistent());
+
+  parser.reset();
+  parse("HTTP/1.0 200 OK\r\nConnection: keep-alive\r\n\r\n");
+  EXPECT_TRUE(parser.is_persistent());
+}
+
+TEST_F(HttpResponseParserTest, invalid_header_should_be_rejected)
+{
+  parse("SSH-2.0-OpenSSH\r\n\r\n");
+  EXPECT_TRUE(parser.has_error());
+
+  parser.reset();
+  parse("HTTP/1.1 200 OK\r\nContent-Length: 12a\r\n\r\n");
+  EXPECT_TRUE(parser.has_error());
+
+  parser.reset();
+  parse("HTTP/1.1 200 OK\r\nServer: " +
+        string(HttpResponseParser::kMaxLineLength, 'x'));
+  EXPECT_TRUE(parser.has_error());
+}
+
+TEST_F(HttpResponseParserTest, vector_search_should_match_scalar_search)
+{
+  constexpr size_t kMaxLength = 300;
+  for (size_t length = 0; length < kMaxLength; ++length) {
+    // Mostly terminator characters, so partial matches are common.
+    string data = get_random_string(length);
+    for (char& byte : data)
+      if (rand() % 4 != 0)
+        byte = rand() % 2 == 0 ? '\r' : '\n';
+
+    EXPECT_EQ(HttpResponseParser::find_header_terminator_scalar(data.c_str(),
+                                                                data.length()),
+              HttpResponseParser::find_header_terminator(data.c_str(),
+                                                         data.length()))
+      << "length: " << length;
+  }
+
+  for (size_t position = 0; position + 4 <= kMaxLength; ++position) {
+    string data(kMaxLength, 'x');
+    data.replace(position, 4, "\r\n\r\n");
+    EXPECT_EQ(position, HttpResponseParser::find_header_terminator(data.c_str(),
+                                                                   data.length()));
+  }
+}
+
+TEST_F(HttpResponseParserTest, terminator_split_between_blocks_should_be_found)
+{
+  // First block is longer than a vector, so it's searched by vector loop.
+  const string kResponse = "HTTP/1.1 200 OK\r\nServer: " + string(100, 'x') +
+                           "\r\n\r\n" + kBody;
+  const size_t kHeaderLength = kResponse.length() - kBody.length();
+  for (size_t split = kHeaderLength - 3; split < kHeaderLength; ++split) {
+    parser.reset();
+    EXPECT_EQ(split, parse(kResponse.substr(0, split)));
+    ASSERT_FALSE(parser.is_complete()) << "split: " << split;
+    EXPECT_EQ(kHeaderLength - split, parse(kResponse.substr(split)))
+      << "split: " << split;
+    EXPECT_TRUE(parser.is_complete()) << "split: " << split;
+  }
+}
+
+TEST_F(HttpResponseParserTest, terminator_in_vector_tail_should_be_found)
+{
+  // Terminator ends the data, in the bytes after the last whole vector.
+  for (size_t length = 4; length < 100; ++length) {
+    string data(length, 'x');
+    data.replace(length - 4, 4, "\r\n\r\n");
+    EXPECT_EQ(length - 4, HttpResponseParser::find_header_terminator(
+                              data.c_str(), data.length()))
+      << "length: " << length;
+    EXPECT_EQ(string_view::npos,
+              HttpResponseParser::find_header_terminator(data.c_str(),
+                                                         data.length() - 1))
+      << "length: " << length;
+  }
+}
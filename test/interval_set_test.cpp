@@ -0,0 +1,114 @@
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "units.h"
+#include "interval_set.h"
+
+using namespace std;
+using namespace std::chrono;
+
+TEST(IntervalSetTest, adjacent_ranges_should_be_coalesced)
+{
+  IntervalSet interval_set;
+  interval_set.insert(0, 100);
+  interval_set.insert(100, 200);
+  interval_set.insert(300, 400);
+
+  EXPECT_EQ(2, interval_set.get_range_count());
+  EXPECT_EQ(300, interval_set.get_length());
+  EXPECT_TRUE(interval_set.contains(0, 200));
+  EXPECT_FALSE(interval_set.contains(150, 350));
+
+  interval_set.insert(200, 300);
+  EXPECT_EQ(1, interval_set.get_range_count());
+  EXPECT_EQ(400, interval_set.get_length());
+  EXPECT_TRUE(interval_set.contains(0, 400));
+}
+
+TEST(IntervalSetTest, overlapping_ranges_should_be_counted_once)
+{
+  IntervalSet interval_set;
+  interval_set.insert(100, 200);
+  interval_set.insert(300, 400);
+  interval_set.insert(500, 600);
+  interval_set.insert(150, 550);
+
+  EXPECT_EQ(1, interval_set.get_range_count());
+  EXPECT_EQ(500, interval_set.get_length());
+
+  // Covered and empty ranges change nothing.
+  interval_set.insert(200, 300);
+  interval_set.insert(700, 700);
+  EXPECT_EQ(1, interval_set.get_range_count());
+  EXPECT_EQ(500, interval_set.get_length());
+
+  interval_set.clear();
+  EXPECT_TRUE(interval_set.empty());
+  EXPECT_EQ(0, interval_set.get_length());
+}
+
+TEST(IntervalSetTest, gaps_should_be_complement_of_ranges)
+{
+  IntervalSet interval_set;
+  interval_set.insert(100, 200);
+  interval_set.insert(300, 400);
+
+  const vector<pair<size_t, size_t>> kGaps = {{0, 100}, {200, 300}, {400, 500}};
+  EXPECT_EQ(kGaps, interval_set.get_gaps(0, 500));
+  const vector<pair<size_t, size_t>> kInnerGaps = {{200, 300}};
+  EXPECT_EQ(kInnerGaps, interval_set.get_gaps(150, 350));
+  EXPECT_TRUE(interval_set.get_gaps(100, 200).empty());
+}
+
+TEST(IntervalSetTest, random_insertion_should_match_bitmap)
+{
+  constexpr size_t kSize = 10000;
+  IntervalSet interval_set;
+  vector<bool> bitmap(kSize, false);
+  for (int i = 0; i < 1000; ++i) {
+    const size_t kStart = rand() % kSize;
+    const size_t kEnd = min(kSize, kStart + rand() % 100);
+    interval_set.insert(kStart, kEnd);
+    for (size_t position = kStart; position < kEnd; ++position)
+      bitmap[position] = true;
+  }
+
+  size_t length = 0;
+  for (bool bit : bitmap)
+    length += bit;
+  EXPECT_EQ(length, interval_set.get_length());
+
+  for (auto [start, end] : interval_set.get_gaps(0, kSize)) {
+    for (size_t position = start; position < end; ++position)
+      ASSERT_FALSE(bitmap[position]) << "position: " << position;
+    length += end - start;
+  }
+  EXPECT_EQ(kSize, length);
+}
+
+TEST(IntervalSetTest, ranges_should_stay_bounded_on_long_downloads)
+{
+  // 100 GB in 64 KB writes by 16 parts.
+  constexpr size_t kParts = 16;
+  constexpr size_t kWriteSize = 64_KB;
+  constexpr size_t kPartSize = 100_GB / kParts;
+  IntervalSet interval_set;
+  auto start = steady_clock::now();
+  for (size_t offset = 0; offset < kPartSize; offset += kWriteSize) {
+    for (size_t part = 0; part < kParts; ++part)
+      interval_set.insert(part * kPartSize + offset,
+                          part * kPartSize + offset + kWriteSize);
+    ASSERT_LE(interval_set.get_range_count(), kParts);
+  }
+  const auto kElapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+
+  cout << "IntervalSet: " << kElapsed.count() << " ms for "
+       << 100_GB / kWriteSize << " insertions" << endl;
+  EXPECT_EQ(100_GB, interval_set.get_length());
+  EXPECT_EQ(1, interval_set.get_range_count());
+}
@@ -0,0 +1,86 @@
+#include <thread>
+#include <vector>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "mpsc_queue.h"
+
+using namespace std;
+
+TEST(MpscQueueTest, capacity_should_be_rounded_up_to_power_of_two)
+{
+  EXPECT_EQ(2, MpscQueue<int>(1).get_capacity());
+  EXPECT_EQ(64, MpscQueue<int>(64).get_capacity());
+  EXPECT_EQ(128, MpscQueue<int>(65).get_capacity());
+}
+
+TEST(MpscQueueTest, values_should_be_popped_in_order)
+{
+  MpscQueue<int> queue(4);
+  int value;
+  EXPECT_FALSE(queue.try_pop(value));
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i)
+      queue.push(i);
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.try_pop(value));
+      EXPECT_EQ(i, value);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+  }
+  EXPECT_EQ(12, queue.get_stats().pushes);
+}
+
+TEST(MpscQueueTest, push_to_full_queue_should_fail)
+{
+  MpscQueue<unique_ptr<int>> queue(2);
+  unique_ptr<int> value = make_unique<int>(1);
+  ASSERT_TRUE(queue.try_push(value));
+  value = make_unique<int>(2);
+  ASSERT_TRUE(queue.try_push(value));
+
+  value = make_unique<int>(3);
+  EXPECT_FALSE(queue.try_push(value));
+  ASSERT_NE(nullptr, value);
+
+  ASSERT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(1, *value);
+}
+
+TEST(MpscQueueTest, values_of_all_producers_should_be_delivered)
+{
+  constexpr size_t kProducers = 4;
+  constexpr size_t kValuesPerProducer = 100000;
+  MpscQueue<size_t> queue(16);
+
+  vector<thread> producers;
+  for (size_t producer = 0; producer < kProducers; ++producer)
+    producers.emplace_back([&queue, producer]() {
+      for (size_t i = 0; i < kValuesPerProducer; ++i)
+        queue.push(producer * kValuesPerProducer + i);
+    });
+
+  // Values of each producer should keep their order.
+  vector<size_t> next_values(kProducers);
+  for (size_t producer = 0; producer < kProducers; ++producer)
+    next_values[producer] = producer * kValuesPerProducer;
+  size_t popped = 0;
+  size_t value;
+  while (popped < kProducers * kValuesPerProducer) {
+    if (!queue.try_pop(value)) {
+      this_thread::yield();
+      continue;
+    }
+    const size_t kProducer = value / kValuesPerProducer;
+    ASSERT_EQ(next_values[kProducer], value);
+    ++next_values[kProducer];
+    ++popped;
+  }
+  for (thread& producer : producers)
+    producer.join();
+
+  EXPECT_FALSE(queue.try_pop(value));
+  EXPECT_EQ(kProducers * kValuesPerProducer, queue.get_stats().pushes);
+}
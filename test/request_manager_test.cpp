@@ -0,0 +1,129 @@
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <iostream>
+#include <condition_variable>
+
+#include <gtest/gtest.h>
+
+#include "units.h"
+#include "request_manager.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Hands every request to downloader at once, without connecting.
+class ImmediateRequestManager : public RequestManager
+{
+  public:
+    ImmediateRequestManager()
+      : RequestManager(nullptr, nullptr)
+    {
+    }
+
+  private:
+    void send_requests() override
+    {
+      for (Request& request : requests) {
+        request.sent = true;
+        notify_dwl_available(request.request_index, nullptr);
+      }
+    }
+};
+
+}   // namespace
+
+class RequestManagerTest : public ::testing::Test
+{
+  void SetUp()
+  {
+    request_manager.register_dwl_notify_cb(
+        [this](size_t index, unique_ptr<SocketOps> sock_ops) {
+          lock_guard<mutex> lock(notify_mutex);
+          notified_index = index;
+          notify_cv.notify_one();
+        });
+    request_manager.start();
+  }
+
+  void TearDown()
+  {
+    if (!stopped) {
+      request_manager.stop();
+      request_manager.join();
+    }
+  }
+
+  protected:
+    // Return true if request_index was notified within timeout.
+    bool wait_notified(size_t request_index, milliseconds timeout)
+    {
+      unique_lock<mutex> lock(notify_mutex);
+      return notify_cv.wait_for(lock, timeout, [&]() {
+        return notified_index == request_index;
+      });
+    }
+
+    ImmediateRequestManager request_manager;
+    mutex notify_mutex;
+    condition_variable notify_cv;
+    size_t notified_index = SIZE_MAX;
+    bool stopped = false;
+};
+
+TEST_F(RequestManagerTest, chunk_turnaround_should_not_wait_for_polling)
+{
+  constexpr int kRounds = 50;
+  // Idle run loop used to sleep 100 ms between checks.
+  constexpr microseconds kMaxMeanTurnaround = milliseconds(5);
+
+  microseconds total_turnaround{0};
+  microseconds max_turnaround{0};
+  for (int i = 0; i < kRounds; ++i) {
+    // Let run loop become idle.
+    this_thread::sleep_for(milliseconds(2));
+    const auto kStart = steady_clock::now();
+    request_manager.add_request(0, 1_KB, i);
+    ASSERT_TRUE(wait_notified(i, seconds(2)));
+    const auto kTurnaround = duration_cast<microseconds>(steady_clock::now() -
+                                                         kStart);
+    total_turnaround += kTurnaround;
+    max_turnaround = max(max_turnaround, kTurnaround);
+  }
+
+  const microseconds kMeanTurnaround = total_turnaround / kRounds;
+  cout << "Chunk turnaround mean: " << kMeanTurnaround.count()
+       << " us, max: " << max_turnaround.count() << " us" << endl;
+  EXPECT_LT(kMeanTurnaround, kMaxMeanTurnaround);
+}
+
+TEST_F(RequestManagerTest, request_index_should_not_be_truncated)
+{
+  // Parts of a 64 GB file in 1 MB chunks, and far beyond.
+  for (size_t index : {size_t(65536), size_t(70000), size_t(1) << 40}) {
+    request_manager.add_request(0, 1_KB, index);
+    EXPECT_TRUE(wait_notified(index, seconds(2))) << "index: " << index;
+  }
+}
+
+TEST_F(RequestManagerTest, stop_should_wake_up_idle_run_loop)
+{
+  this_thread::sleep_for(milliseconds(10));
+  const auto kStart = steady_clock::now();
+  request_manager.stop();
+  request_manager.join();
+  stopped = true;
+
+  EXPECT_LT(steady_clock::now() - kStart, milliseconds(100));
+}
+
+TEST_F(RequestManagerTest, probe_response_should_be_empty_without_link_check)
+{
+  ProbeResponse probe_response = request_manager.take_probe_response();
+
+  EXPECT_EQ(nullptr, probe_response.sock_ops);
+  EXPECT_EQ(0, probe_response.body.length());
+}
@@ -1,6 +1,11 @@
+#include <map>
+#include <queue>
 #include <tuple>
 #include <cmath>
 #include <memory>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include <exception>
 
 #include <gtest/gtest.h>
@@ -61,6 +66,9 @@ TEST_F(StateManagerTest, set_chunk_size_should_work_properly)
 
   state_manager.set_chunk_size(kNewChunkSize);
   EXPECT_EQ(kNewChunkSize, state_manager.get_chunk_size());
+
+  state_manager.set_chunk_size(StateManager::kMinChunkSize);
+  EXPECT_EQ(StateManager::kMinChunkSize, state_manager.get_chunk_size());
 }
 
 TEST_F(StateManagerTest, size_of_part_should_be_equal_to_current_chunk_size_0)
@@ -141,6 +149,35 @@ void store_fake_data(vector<tuple<size_t, size_t, size_t, size_t>>& data,
   file_io->set_existence(true);
 }
 
+TEST_F(StateManagerTest, part_should_have_requested_chunk_size)
+{
+  constexpr size_t kChunkSize = 3_MB;
+  state_manager.get_part();
+  pair<size_t, Chunk> part = state_manager.get_part(kChunkSize);
+  EXPECT_EQ(kChunkSize, part.second.end - part.second.start);
+
+  part = state_manager.get_part();
+  EXPECT_EQ(state_manager.get_chunk_size(), part.second.end - part.second.start);
+}
+
+TEST_F(StateManagerTest, retrieved_last_part_should_be_truncated_to_requested_chunk_size)
+{
+  constexpr size_t kFileSize = 100_MB;
+  constexpr size_t kChunkSize = 5_MB;
+  vector<tuple<size_t, size_t, size_t, size_t>> data = {
+    {0, 0, 1000, kFileSize}
+  };
+
+  store_fake_data(data, state_manager.get_file_io(), kFileSize);
+  state_manager.retrieve();
+
+  pair<size_t, Chunk> part = state_manager.get_part(kChunkSize);
+  EXPECT_EQ(1000 + kChunkSize, part.second.end);
+  part = state_manager.get_part(kChunkSize);
+  EXPECT_EQ(1000 + kChunkSize, part.second.start);
+  EXPECT_EQ(1000 + 2 * kChunkSize, part.second.end);
+}
+
 TEST_F(StateManagerTest, retrived_state_file_contents_check_0)
 {
 
@@ -204,3 +241,490 @@ TEST(StateManagerTestChunkNotAvailable,
   EXPECT_TRUE(state_manager.part_available());
 }
 
+
+TEST_F(StateManagerTest, stored_state_should_be_retrieved_by_new_state_manager)
+{
+  pair<size_t, Chunk> part_0 = state_manager.get_part();
+  pair<size_t, Chunk> part_1 = state_manager.get_part();
+  state_manager.update(part_0.first, 1000);
+  state_manager.update(part_1.first, 2000);
+  state_manager.checkpoint();
+
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+
+  EXPECT_EQ(kFileSize, retrieved_state_manager.get_file_size());
+  EXPECT_EQ(3000, retrieved_state_manager.get_total_recvd_bytes());
+  queue<pair<size_t, Chunk>> parts = retrieved_state_manager.get_initial_parts();
+  ASSERT_EQ(2, parts.size());
+  EXPECT_EQ(part_0.first, parts.front().first);
+  EXPECT_EQ(part_0.second.current + 1000, parts.front().second.current);
+  EXPECT_EQ(part_0.second.end, parts.front().second.end);
+  parts.pop();
+  EXPECT_EQ(part_1.first, parts.front().first);
+  EXPECT_EQ(part_1.second.current + 2000, parts.front().second.current);
+}
+
+TEST_F(StateManagerTest, update_should_not_change_state_file_length)
+{
+  pair<size_t, Chunk> part = state_manager.get_part();
+  const size_t kStateLength = state_manager.get_file_io()->get_file_contents().length();
+
+  state_manager.update(part.first, 1000);
+  EXPECT_EQ(kStateLength,
+            state_manager.get_file_io()->get_file_contents().length());
+}
+
+TEST_F(StateManagerTest, text_state_file_should_be_converted_to_binary)
+{
+  vector<tuple<size_t, size_t, size_t, size_t>> data = {
+    {0 ,0 ,398088 ,1167557}
+  };
+  FileIOMock* file_io = state_manager.get_file_io();
+  store_fake_data(data, file_io, kFileSize);
+  state_manager.retrieve();
+
+  string contents = file_io->get_file_contents();
+  EXPECT_EQ("DMST", contents.substr(0, 4));
+}
+
+TEST_F(StateManagerTest, newer_state_file_version_should_throw_exception)
+{
+  string contents = state_manager.get_file_io()->get_file_contents();
+  const uint32_t kNewerVersion = StateManager::kStateVersion + 1;
+  contents.replace(4, sizeof(kNewerVersion),
+                   reinterpret_cast<const char*>(&kNewerVersion),
+                   sizeof(kNewerVersion));
+  state_manager.set_raw_stat_data(contents);
+  state_manager.get_file_io()->set_existence(true);
+
+  EXPECT_THROW(state_manager.retrieve(), runtime_error);
+}
+
+TEST_F(StateManagerTest, validator_should_be_retrieved_from_state_file)
+{
+  const string kValidator = "\"5e-1a\"";
+  state_manager.set_validator(kValidator);
+
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+
+  EXPECT_EQ(kValidator, retrieved_state_manager.get_validator());
+  EXPECT_TRUE(retrieved_state_manager.matches_remote_file(kFileSize, kValidator));
+  EXPECT_TRUE(retrieved_state_manager.matches_remote_file(kFileSize, ""));
+  EXPECT_FALSE(retrieved_state_manager.matches_remote_file(kFileSize, "\"5e-1b\""));
+  EXPECT_FALSE(retrieved_state_manager.matches_remote_file(kFileSize + 1,
+                                                           kValidator));
+}
+
+TEST_F(StateManagerTest, too_long_validator_should_not_be_stored)
+{
+  state_manager.set_validator(string(StateManager::kMaxValidatorLength + 1, 'x'));
+
+  EXPECT_TRUE(state_manager.get_validator().empty());
+}
+
+TEST_F(StateManagerTest, version_1_state_file_should_be_converted)
+{
+  const uint32_t kVersion = 1;
+  const uint64_t kSize = kFileSize;
+  const uint64_t kRecord[] = {0, 0, 500, 999};
+  string contents = "DMST";
+  contents.append(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  contents.append(reinterpret_cast<const char*>(&kSize), sizeof(kSize));
+  contents.append(reinterpret_cast<const char*>(kRecord), sizeof(kRecord));
+  state_manager.set_raw_stat_data(contents);
+  state_manager.get_file_io()->set_existence(true);
+  state_manager.retrieve();
+
+  EXPECT_TRUE(state_manager.get_validator().empty());
+  EXPECT_EQ(500, state_manager.get_total_recvd_bytes());
+  uint32_t version;
+  memcpy(&version, state_manager.get_file_io()->get_file_contents().data() + 4,
+         sizeof(version));
+  EXPECT_EQ(StateManager::kStateVersion, version);
+
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+  EXPECT_EQ(500, retrieved_state_manager.get_total_recvd_bytes());
+}
+
+TEST_F(StateManagerTest, new_state_should_discard_retrieved_parts)
+{
+  pair<size_t, Chunk> part = state_manager.get_part();
+  state_manager.update(part.first, 1000);
+  state_manager.checkpoint();
+  state_manager.get_file_io()->set_existence(true);
+  state_manager.retrieve();
+
+  state_manager.create_new_state(kFileSize);
+
+  EXPECT_EQ(0, state_manager.get_total_recvd_bytes());
+  EXPECT_TRUE(state_manager.get_initial_parts().empty());
+  EXPECT_EQ(0, state_manager.get_part().second.current);
+}
+
+TEST_F(StateManagerTest, recover_should_rebuild_parts_from_data_ranges)
+{
+  constexpr size_t kBlockSize = 4096;
+  const vector<pair<size_t, size_t>> kDataRanges = {
+    {0, 100 * kBlockSize},
+    {300 * kBlockSize, 400 * kBlockSize}
+  };
+  ASSERT_TRUE(state_manager.recover(kFileSize, kDataRanges, kBlockSize));
+
+  // Edge blocks may be written partially.
+  EXPECT_EQ(99 * kBlockSize + 98 * kBlockSize,
+            state_manager.get_total_recvd_bytes());
+  queue<pair<size_t, Chunk>> parts = state_manager.get_initial_parts();
+  ASSERT_EQ(2, parts.size());
+  EXPECT_EQ(Chunk(99 * kBlockSize, 99 * kBlockSize, 301 * kBlockSize - 1),
+            parts.front().second);
+  parts.pop();
+  EXPECT_EQ(Chunk(399 * kBlockSize, 399 * kBlockSize, kFileSize),
+            parts.front().second);
+
+  // Recovered state is stored.
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+  EXPECT_EQ(state_manager.get_total_recvd_bytes(),
+            retrieved_state_manager.get_total_recvd_bytes());
+}
+
+TEST_F(StateManagerTest, recover_should_add_part_before_first_data_range)
+{
+  constexpr size_t kBlockSize = 4096;
+  ASSERT_TRUE(state_manager.recover(kFileSize, {{kFileSize / 2, kFileSize}},
+                                    kBlockSize));
+
+  queue<pair<size_t, Chunk>> parts = state_manager.get_initial_parts();
+  ASSERT_EQ(2, parts.size());
+  EXPECT_EQ(Chunk(0, 0, kFileSize / 2 + kBlockSize - 1), parts.front().second);
+  parts.pop();
+  EXPECT_EQ(kFileSize, parts.front().second.end);
+}
+
+TEST_F(StateManagerTest, recover_should_not_trust_range_of_whole_file)
+{
+  EXPECT_FALSE(state_manager.recover(kFileSize, {{0, kFileSize}}, 4096));
+  EXPECT_FALSE(state_manager.recover(kFileSize, {}, 4096));
+  // Only partially written blocks.
+  EXPECT_FALSE(state_manager.recover(kFileSize, {{8192, 12288}}, 4096));
+}
+
+TEST_F(StateManagerTest, split_part_should_truncate_part_and_create_tail)
+{
+  pair<size_t, Chunk> part = state_manager.get_part();
+  while (state_manager.part_available())
+    state_manager.get_part();
+
+  const size_t kSplitPosition = part.second.current + 1000;
+  pair<size_t, Chunk> tail = state_manager.split_part(part.first, kSplitPosition);
+
+  EXPECT_EQ(kSplitPosition + 1, tail.second.current);
+  EXPECT_EQ(part.second.end, tail.second.end);
+  EXPECT_FALSE(state_manager.part_available());
+
+  // Both parts are stored.
+  StateManagerTestClass new_state_manager;
+  new_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  new_state_manager.get_file_io()->set_existence(true);
+  new_state_manager.retrieve();
+  map<size_t, Chunk> retrieved_parts;
+  queue<pair<size_t, Chunk>> initial_parts = new_state_manager.get_initial_parts();
+  for (; !initial_parts.empty(); initial_parts.pop())
+    retrieved_parts.insert(initial_parts.front());
+
+  EXPECT_EQ(kSplitPosition, retrieved_parts.at(part.first).end);
+  EXPECT_EQ(part.second.end, retrieved_parts.at(tail.first).end);
+}
+
+TEST_F(StateManagerTest, split_part_outside_of_remaining_range_should_throw)
+{
+  pair<size_t, Chunk> part = state_manager.get_part();
+  EXPECT_THROW(state_manager.split_part(part.first, part.second.end),
+               runtime_error);
+  EXPECT_THROW(state_manager.split_part(part.first + 1, part.second.current),
+               runtime_error);
+}
+
+TEST_F(StateManagerTest, split_parts_should_be_merged_when_finished)
+{
+  pair<size_t, Chunk> part = state_manager.get_part();
+  const size_t kSplitPosition = part.second.end / 2;
+  pair<size_t, Chunk> tail = state_manager.split_part(part.first, kSplitPosition);
+
+  // End of parts is inclusive.
+  state_manager.update(tail.first, tail.second.end + 1 - tail.second.current);
+  state_manager.update(part.first, kSplitPosition + 1);
+  state_manager.checkpoint();
+  EXPECT_EQ(1, state_manager.get_completed_ranges().get_range_count());
+
+  StateManagerTestClass new_state_manager;
+  new_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  new_state_manager.get_file_io()->set_existence(true);
+  new_state_manager.retrieve();
+  EXPECT_EQ(0, new_state_manager.get_initial_parts().size());
+  EXPECT_EQ(part.second.end + 1, new_state_manager.get_total_recvd_bytes());
+}
+
+TEST_F(StateManagerTest, finished_parts_should_not_grow_state_file)
+{
+  pair<size_t, Chunk> part = state_manager.get_part();
+  const size_t kStateLength = state_manager.get_file_io()->get_file_contents().length();
+  size_t recvd_bytes = 0;
+  for (int i = 0; i < 100; ++i) {
+    const size_t kPartSize = part.second.end + 1 - part.second.current;
+    state_manager.update(part.first, kPartSize);
+    recvd_bytes += kPartSize;
+    part = state_manager.get_part();
+  }
+
+  EXPECT_EQ(kStateLength, state_manager.get_file_io()->get_file_contents().length());
+  EXPECT_EQ(recvd_bytes, state_manager.get_total_recvd_bytes());
+  EXPECT_EQ(1, state_manager.get_completed_ranges().get_range_count());
+
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+  EXPECT_EQ(recvd_bytes, retrieved_state_manager.get_total_recvd_bytes());
+  queue<pair<size_t, Chunk>> parts = retrieved_state_manager.get_initial_parts();
+  ASSERT_EQ(1, parts.size());
+  EXPECT_EQ(part, parts.front());
+}
+
+TEST_F(StateManagerTest, out_of_order_parts_should_be_coalesced)
+{
+  vector<pair<size_t, Chunk>> parts;
+  while (state_manager.part_available())
+    parts.push_back(state_manager.get_part());
+
+  // Every other part, then the rest.
+  for (size_t i = 0; i < parts.size(); i += 2)
+    state_manager.update(parts[i].first,
+                         min(parts[i].second.end + 1, kFileSize) -
+                         parts[i].second.current);
+  EXPECT_EQ(parts.size() / 2, state_manager.get_completed_ranges().get_range_count());
+  for (size_t i = 1; i < parts.size(); i += 2)
+    state_manager.update(parts[i].first,
+                         min(parts[i].second.end + 1, kFileSize) -
+                         parts[i].second.current);
+
+  EXPECT_EQ(1, state_manager.get_completed_ranges().get_range_count());
+  EXPECT_EQ(kFileSize, state_manager.get_total_recvd_bytes());
+}
+
+TEST_F(StateManagerTest, version_2_state_file_should_be_converted)
+{
+  const uint32_t kVersion = 2;
+  const uint64_t kSize = kFileSize;
+  const uint64_t kValidatorLength = 0;
+  // Finished part, unfinished part and empty slot.
+  const uint64_t kRecords[] = {0, 0, 1000, 999,
+                               1, 999, 1500, 1999,
+                               UINT64_MAX, 0, 0, 0};
+  string contents = "DMST";
+  contents.append(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  contents.append(reinterpret_cast<const char*>(&kSize), sizeof(kSize));
+  contents.append(reinterpret_cast<const char*>(&kValidatorLength),
+                  sizeof(kValidatorLength));
+  contents.append(StateManager::kMaxValidatorLength, '\0');
+  contents.append(reinterpret_cast<const char*>(kRecords), sizeof(kRecords));
+  state_manager.set_raw_stat_data(contents);
+  state_manager.get_file_io()->set_existence(true);
+  state_manager.retrieve();
+
+  EXPECT_EQ(1500, state_manager.get_total_recvd_bytes());
+  queue<pair<size_t, Chunk>> parts = state_manager.get_initial_parts();
+  ASSERT_EQ(1, parts.size());
+  EXPECT_EQ(1, parts.front().first);
+  EXPECT_EQ(1500, state_manager.get_part().second.current);
+  EXPECT_EQ(2000, state_manager.get_part().second.current);
+
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+  EXPECT_EQ(1500, retrieved_state_manager.get_total_recvd_bytes());
+}
+
+TEST_F(StateManagerTest, parts_of_multi_terabyte_file_should_have_distinct_indices)
+{
+  // Over a million parts, indices used to wrap at 65536.
+  constexpr size_t kLargeFileSize = 4_TB + 12345;
+  constexpr size_t kChunkSize = 4_MB;
+  state_manager.create_new_state(kLargeFileSize);
+  state_manager.set_chunk_size(kChunkSize);
+  const size_t kStateLength = state_manager.get_file_io()->get_file_contents().length();
+
+  size_t expected_index = 0;
+  size_t expected_current = 0;
+  while (state_manager.part_available()) {
+    pair<size_t, Chunk> part = state_manager.get_part();
+    ASSERT_EQ(expected_index++, part.first);
+    ASSERT_EQ(expected_current, part.second.current);
+    expected_current = min(part.second.end + 1, kLargeFileSize);
+    state_manager.update(part.first, expected_current - part.second.current);
+  }
+
+  EXPECT_EQ(kLargeFileSize / kChunkSize + 1, expected_index);
+  EXPECT_EQ(kLargeFileSize, state_manager.get_total_recvd_bytes());
+  EXPECT_EQ(1, state_manager.get_completed_ranges().get_range_count());
+  EXPECT_EQ(kStateLength + 32,
+            state_manager.get_file_io()->get_file_contents().length());
+}
+
+TEST_F(StateManagerTest, state_of_multi_terabyte_file_should_be_retrieved)
+{
+  constexpr size_t kLargeFileSize = 16_TB;
+  state_manager.create_new_state(kLargeFileSize);
+  state_manager.set_chunk_size(1_GB);
+  vector<pair<size_t, Chunk>> parts;
+  for (int i = 0; i < 100; ++i)
+    parts.push_back(state_manager.get_part());
+  // A part split far beyond 4 GB.
+  pair<size_t, Chunk> tail = state_manager.split_part(parts.back().first,
+                                                      parts.back().second.end - 1_MB);
+  state_manager.update(parts.back().first, 1000);
+  state_manager.update(tail.first, 2000);
+  state_manager.checkpoint();
+
+  StateManagerTestClass retrieved_state_manager;
+  retrieved_state_manager.set_raw_stat_data(
+      state_manager.get_file_io()->get_file_contents());
+  retrieved_state_manager.get_file_io()->set_existence(true);
+  retrieved_state_manager.retrieve();
+
+  EXPECT_EQ(kLargeFileSize, retrieved_state_manager.get_file_size());
+  EXPECT_EQ(3000, retrieved_state_manager.get_total_recvd_bytes());
+  map<size_t, Chunk> retrieved_parts;
+  queue<pair<size_t, Chunk>> initial_parts =
+    retrieved_state_manager.get_initial_parts();
+  for (; !initial_parts.empty(); initial_parts.pop())
+    retrieved_parts.insert(initial_parts.front());
+  EXPECT_EQ(101, retrieved_parts.size());
+  EXPECT_EQ(tail.second.current + 2000, retrieved_parts.at(tail.first).current);
+  EXPECT_EQ(100 * 1_GB, retrieved_parts.at(tail.first).end);
+}
+
+TEST_F(StateManagerTest, streaming_state_should_have_one_part_until_finished)
+{
+  constexpr size_t kStreamSize = 12345;
+  state_manager.create_streaming_state();
+
+  ASSERT_TRUE(state_manager.is_streaming());
+  pair<size_t, Chunk> part = state_manager.get_part();
+  EXPECT_EQ(0, part.second.start);
+  EXPECT_EQ(StateManager::kUnknownFileSize, part.second.end);
+  EXPECT_FALSE(state_manager.part_available());
+
+  state_manager.update(part.first, kStreamSize);
+  state_manager.finish_stream(kStreamSize);
+
+  EXPECT_FALSE(state_manager.is_streaming());
+  EXPECT_EQ(kStreamSize, state_manager.get_file_size());
+  EXPECT_EQ(kStreamSize, state_manager.get_total_recvd_bytes());
+  EXPECT_FALSE(state_manager.part_available());
+}
+
+TEST_F(StateManagerTest, finished_stream_should_wait_for_pending_writes)
+{
+  constexpr size_t kStreamSize = 12345;
+  state_manager.create_streaming_state();
+  pair<size_t, Chunk> part = state_manager.get_part();
+
+  state_manager.update(part.first, kStreamSize / 2);
+  state_manager.finish_stream(kStreamSize);
+  EXPECT_LT(state_manager.get_total_recvd_bytes(), state_manager.get_file_size());
+
+  state_manager.update(part.first, kStreamSize - kStreamSize / 2);
+  EXPECT_EQ(state_manager.get_file_size(), state_manager.get_total_recvd_bytes());
+}
+
+class StateManagerCheckpointTest : public StateManagerTest
+{
+  protected:
+    // Current position of part stored in .stat file.
+    size_t get_stored_current(size_t index)
+    {
+      StateManagerTestClass retrieved_state_manager;
+      retrieved_state_manager.set_raw_stat_data(
+          state_manager.get_file_io()->get_file_contents());
+      retrieved_state_manager.get_file_io()->set_existence(true);
+      retrieved_state_manager.retrieve();
+
+      queue<pair<size_t, Chunk>> parts =
+        retrieved_state_manager.get_initial_parts();
+      for (; !parts.empty(); parts.pop())
+        if (parts.front().first == index)
+          return parts.front().second.current;
+
+      return 0;
+    }
+};
+
+TEST_F(StateManagerCheckpointTest, state_should_be_stored_after_byte_threshold)
+{
+  CheckpointPolicy policy;
+  policy.bytes = 3000;
+  policy.interval_ms = 0;
+  state_manager.set_checkpoint_policy(policy);
+  pair<size_t, Chunk> part = state_manager.get_part();
+
+  state_manager.update(part.first, 2000);
+  EXPECT_EQ(part.second.current, get_stored_current(part.first));
+
+  state_manager.update(part.first, 1000);
+  EXPECT_EQ(part.second.current + 3000, get_stored_current(part.first));
+}
+
+TEST_F(StateManagerCheckpointTest, state_should_be_stored_after_interval)
+{
+  CheckpointPolicy policy;
+  policy.bytes = 0;
+  policy.interval_ms = 20;
+  state_manager.set_checkpoint_policy(policy);
+  pair<size_t, Chunk> part = state_manager.get_part();
+
+  state_manager.checkpoint();
+  state_manager.update(part.first, 10);
+  EXPECT_EQ(part.second.current, get_stored_current(part.first));
+
+  this_thread::sleep_for(chrono::milliseconds(policy.interval_ms));
+  state_manager.update(part.first, 10);
+  EXPECT_EQ(part.second.current + 20, get_stored_current(part.first));
+}
+
+TEST_F(StateManagerCheckpointTest, state_should_be_stored_on_chunk_finish)
+{
+  CheckpointPolicy policy;
+  policy.bytes = 0;
+  policy.interval_ms = 0;
+  state_manager.set_checkpoint_policy(policy);
+  pair<size_t, Chunk> part_0 = state_manager.get_part();
+  pair<size_t, Chunk> part_1 = state_manager.get_part();
+
+  state_manager.update(part_1.first, 10);
+  EXPECT_EQ(part_1.second.current, get_stored_current(part_1.first));
+
+  const size_t kRemaining = part_0.second.end + 1 - part_0.second.current;
+  state_manager.update(part_0.first, kRemaining);
+  EXPECT_EQ(part_1.second.current + 10, get_stored_current(part_1.first));
+}
@@ -11,12 +11,14 @@ FileIOMock::FileIOMock()
   : FileIO("NEVER_CREATING_FILE_NAME")
   , file_opened(false)
   , existence(false)
+  , file_length(0)
 {
 }
 
 void FileIOMock::create(size_t file_length)
 {
   file_buffer = make_unique<char[]>(file_length);
+  this->file_length = file_length;
   file_opened = true;
 }
 
@@ -25,9 +27,17 @@ void FileIOMock::open()
   file_opened = true;
 }
 
-void FileIOMock::write(const char* buffer, size_t length, size_t position)
+bool FileIOMock::write(const char* buffer, size_t length, size_t position)
 {
+  // Grow like a real file.
+  if (position + length > file_length) {
+    unique_ptr<char[]> new_buffer = make_unique<char[]>(position + length);
+    memcpy(new_buffer.get(), file_buffer.get(), file_length);
+    file_buffer = move(new_buffer);
+    file_length = position + length;
+  }
   memcpy(file_buffer.get() + position, buffer, length);
+  return true;
 }
 
 char* FileIOMock::get_file_buffer()
@@ -47,12 +57,13 @@ void FileIOMock::set_existence(bool input)
 
 string FileIOMock::get_file_contents()
 {
-  return string(file_buffer.get());
+  return string(file_buffer.get(), file_length);
 }
 
-void StatFileIOMock::write(const char* buffer, size_t length, size_t position)
+bool StatFileIOMock::write(const char* buffer, size_t length, size_t position)
 {
   file_contents.replace(position, length, buffer);
+  return true;
 }
 
 string StatFileIOMock::get_file_contents()
@@ -13,7 +13,7 @@ class FileIOMock : public FileIO
     FileIOMock();
     virtual void create(size_t file_length = 0) override;
     void open() override;
-    void write(const char* buffer, size_t length, size_t position=0) override;
+    bool write(const char* buffer, size_t length, size_t position=0) override;
     char* get_file_buffer();
     bool check_existence() const override;
     void set_existence(bool input);
@@ -26,13 +26,14 @@ class FileIOMock : public FileIO
 
   private:
     std::unique_ptr<char[]> file_buffer;
+    size_t file_length;
 };
 
 class StatFileIOMock : public FileIOMock
 {
   public:
     using FileIOMock::FileIOMock;
-    void write(const char* buffer, size_t length, size_t position=0) override;
+    bool write(const char* buffer, size_t length, size_t position=0) override;
     std::string get_file_contents() override;
 };
 
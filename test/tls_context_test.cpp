@@ -0,0 +1,292 @@
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <gtest/gtest.h>
+
+#include "buffer.h"
+#include "tls_context.h"
+#include "epoll_event_loop.h"
+#include "https_socket_ops.h"
+#include "https_transceiver.h"
+
+using namespace std;
+
+namespace {
+
+// Loopback TLS 1.3 server with self-signed certificate, answers one request
+// on each accepted connection.
+class TlsServer
+{
+  public:
+    TlsServer()
+    {
+      EVP_PKEY_CTX* key_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+      EVP_PKEY_keygen_init(key_ctx);
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx, NID_X9_62_prime256v1);
+      EVP_PKEY_keygen(key_ctx, &key);
+      EVP_PKEY_CTX_free(key_ctx);
+
+      cert = X509_new();
+      X509_set_version(cert, 2);
+      ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+      X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+      X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+      X509_set_pubkey(cert, key);
+      X509_NAME* name = X509_get_subject_name(cert);
+      X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+          reinterpret_cast<const unsigned char*>("127.0.0.1"), -1, -1, 0);
+      X509_set_issuer_name(cert, name);
+      X509_sign(cert, key, EVP_sha256());
+
+      ctx = SSL_CTX_new(TLS_server_method());
+      SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION);
+      SSL_CTX_use_certificate(ctx, cert);
+      SSL_CTX_use_PrivateKey(ctx, key);
+      SSL_CTX_set_max_early_data(ctx, 16384);
+
+      listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bind(listen_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+      listen(listen_socket, 8);
+      socklen_t length = sizeof(address);
+      getsockname(listen_socket, reinterpret_cast<sockaddr*>(&address), &length);
+      port = ntohs(address.sin_port);
+    }
+
+    ~TlsServer()
+    {
+      close(listen_socket);
+      SSL_CTX_free(ctx);
+      X509_free(cert);
+      EVP_PKEY_free(key);
+    }
+
+    // Early data of resumed sessions is rejected if disabled.
+    void set_early_data(bool enabled)
+    {
+      SSL_CTX_set_max_early_data(ctx, enabled ? 16384 : 0);
+    }
+
+    // Serves one connection, return received request.
+    string serve()
+    {
+      int socket = accept(listen_socket, nullptr, nullptr);
+      SSL* ssl = SSL_new(ctx);
+      SSL_set_fd(ssl, socket);
+
+      string request;
+      char buffer[4096];
+      size_t length = 0;
+      int result;
+      while ((result = SSL_read_early_data(ssl, buffer, sizeof(buffer), &length))
+             == SSL_READ_EARLY_DATA_SUCCESS)
+        request.append(buffer, length);
+      if (result == SSL_READ_EARLY_DATA_FINISH && SSL_do_handshake(ssl) == 1) {
+        while (request.find("\r\n\r\n") == string::npos) {
+          int recvd_bytes = SSL_read(ssl, buffer, sizeof(buffer));
+          if (recvd_bytes <= 0)
+            break;
+          request.append(buffer, recvd_bytes);
+        }
+        const string kResponse = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+        SSL_write(ssl, kResponse.c_str(), kResponse.length());
+        SSL_shutdown(ssl);
+      }
+      SSL_free(ssl);
+      close(socket);
+
+      return request;
+    }
+
+    uint16_t port;
+
+  private:
+    EVP_PKEY* key = nullptr;
+    X509* cert = nullptr;
+    SSL_CTX* ctx = nullptr;
+    int listen_socket;
+};
+
+}   // namespace
+
+class TlsContextTest : public ::testing::Test
+{
+  protected:
+    // Sends a request on new connection and reads the response, return
+    // request received by server.
+    string request_once()
+    {
+      string recvd_request;
+      thread server_thread([&]() { recvd_request = server.serve(); });
+
+      HttpsSocketOps sock_ops("127.0.0.1", server.port, "127.0.0.1");
+      Buffer request(string("GET / HTTP/1.1\r\n\r\n"));
+      sock_ops.set_early_data(request, request.length());
+      EXPECT_TRUE(sock_ops.connect());
+      HttpsTransceiver transceiver;
+      EXPECT_TRUE(transceiver.send(request, &sock_ops));
+      Buffer response;
+      // Session tickets are processed while reading.
+      do {
+        transceiver.receive(response, &sock_ops);
+      } while (response.length() > 0);
+
+      server_thread.join();
+      return recvd_request;
+    }
+
+    TlsServer server;
+    TlsContext& tls_context = TlsContext::get_instance();
+};
+
+TEST_F(TlsContextTest, second_connection_should_resume_session)
+{
+  const TlsContext::Stats kStats = tls_context.get_stats();
+  request_once();
+  request_once();
+
+  const TlsContext::Stats kNewStats = tls_context.get_stats();
+  EXPECT_EQ(kStats.handshakes + 2, kNewStats.handshakes);
+  EXPECT_EQ(kStats.resumed_handshakes + 1, kNewStats.resumed_handshakes);
+}
+
+TEST_F(TlsContextTest, request_should_be_sent_in_early_data_if_enabled)
+{
+  tls_context.set_early_data(true);
+  const TlsContext::Stats kStats = tls_context.get_stats();
+  request_once();
+  const string kRequest = request_once();
+  tls_context.set_early_data(false);
+
+  EXPECT_EQ("GET / HTTP/1.1\r\n\r\n", kRequest);
+  const TlsContext::Stats kNewStats = tls_context.get_stats();
+  EXPECT_EQ(kStats.early_data_accepted + 1, kNewStats.early_data_accepted);
+}
+
+TEST_F(TlsContextTest, rejected_early_data_should_be_sent_again)
+{
+  tls_context.set_early_data(true);
+  request_once();
+  const TlsContext::Stats kStats = tls_context.get_stats();
+  server.set_early_data(false);
+  const string kRequest = request_once();
+  server.set_early_data(true);
+  tls_context.set_early_data(false);
+
+  EXPECT_EQ("GET / HTTP/1.1\r\n\r\n", kRequest);
+  EXPECT_EQ(kStats.early_data_accepted,
+            tls_context.get_stats().early_data_accepted);
+}
+
+TEST_F(TlsContextTest, early_data_handshake_should_wait_for_server)
+{
+  tls_context.set_early_data(true);
+  request_once();
+  const TlsContext::Stats kStats = tls_context.get_stats();
+
+  HttpsSocketOps sock_ops("127.0.0.1", server.port, "127.0.0.1");
+  Buffer request(string("GET / HTTP/1.1\r\n\r\n"));
+  sock_ops.set_early_data(request, request.length());
+  // Continues connecting on readiness until it's not in progress or timed out.
+  auto connect = [&sock_ops](ConnectStatus status, int timeout_ms) {
+    while (status == ConnectStatus::IN_PROGRESS) {
+      pollfd poll_fd{sock_ops.get_socket_descriptor(),
+                     static_cast<short>(sock_ops.connect_wants_write() ? POLLOUT
+                                                                      : POLLIN),
+                     0};
+      if (poll(&poll_fd, 1, timeout_ms) != 1)
+        break;
+      status = sock_ops.continue_connect();
+    }
+    return status;
+  };
+  // Server isn't answering yet, handshake can't be finished.
+  ConnectStatus status = connect(sock_ops.start_connect(), 100);
+  ASSERT_EQ(ConnectStatus::IN_PROGRESS, status);
+
+  string recvd_request;
+  thread server_thread([&]() { recvd_request = server.serve(); });
+  status = connect(status, 5000);
+  ASSERT_EQ(ConnectStatus::CONNECTED, status);
+  ASSERT_TRUE(sock_ops.set_non_blocking(false));
+
+  HttpsTransceiver transceiver;
+  EXPECT_TRUE(transceiver.send(request, &sock_ops));
+  Buffer response;
+  do {
+    transceiver.receive(response, &sock_ops);
+  } while (response.length() > 0);
+  server_thread.join();
+  tls_context.set_early_data(false);
+
+  EXPECT_EQ("GET / HTTP/1.1\r\n\r\n", recvd_request);
+  EXPECT_EQ(kStats.early_data_accepted + 1,
+            tls_context.get_stats().early_data_accepted);
+}
+
+TEST_F(TlsContextTest, handshake_time_should_be_measured)
+{
+  const TlsContext::Stats kStats = tls_context.get_stats();
+  request_once();
+
+  EXPECT_GT(tls_context.get_stats().handshake_time, kStats.handshake_time);
+}
+
+TEST_F(TlsContextTest, handshakes_should_progress_on_readiness_events)
+{
+  constexpr size_t kConnections = 2;
+  EpollEventLoop event_loop;
+  vector<unique_ptr<HttpsSocketOps>> connections;
+  size_t connecting = 0;
+  for (size_t i = 0; i < kConnections; ++i) {
+    connections.push_back(
+        make_unique<HttpsSocketOps>("127.0.0.1", server.port, "127.0.0.1"));
+    // Server doesn't answer before both are started.
+    ASSERT_EQ(ConnectStatus::IN_PROGRESS, connections[i]->start_connect());
+    ASSERT_TRUE(event_loop.add(connections[i]->get_socket_descriptor(), i, true));
+    ++connecting;
+  }
+
+  thread server_threads[kConnections];
+  for (thread& server_thread : server_threads)
+    server_thread = thread([&]() { server.serve(); });
+
+  vector<size_t> ready_keys;
+  while (connecting > 0) {
+    ASSERT_GT(event_loop.wait(ready_keys, 1000), 0);
+    for (size_t index : ready_keys) {
+      ConnectStatus status = connections[index]->continue_connect();
+      ASSERT_NE(ConnectStatus::FAILED, status);
+      if (status == ConnectStatus::CONNECTED) {
+        event_loop.remove(connections[index]->get_socket_descriptor());
+        --connecting;
+      }
+    }
+  }
+
+  HttpsTransceiver transceiver;
+  for (auto& connection : connections) {
+    ASSERT_TRUE(connection->set_non_blocking(false));
+    Buffer request(string("GET / HTTP/1.1\r\n\r\n"));
+    transceiver.send(request, connection.get());
+    Buffer response;
+    transceiver.receive(response, connection.get());
+    EXPECT_GT(response.length(), 0);
+  }
+  for (thread& server_thread : server_threads)
+    server_thread.join();
+}
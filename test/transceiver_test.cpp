@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
+#include "connection.h"
 #include "transceiver.h"
+#include "http_transceiver.h"
 
 using namespace std;
 
@@ -15,3 +17,168 @@ class TransceiverTest : public ::testing::Test
 TEST_F(TransceiverTest, _)
 {
 }
+
+class HttpTransceiverTest : public ::testing::Test
+{
+  protected:
+    HttpTransceiver transceiver;
+    Connection connection;
+};
+
+TEST_F(HttpTransceiverTest, skip_header_should_return_body_in_place)
+{
+  const string kHeader = "HTTP/1.1 206 Partial Content\r\n"
+                         "Content-Range: bytes 0-3/10\r\n"
+                         "Content-Length: 4\r\n\r\n";
+  Buffer buffer(kHeader + "body");
+  const size_t kBodyOffset = transceiver.skip_header(buffer, connection);
+
+  EXPECT_TRUE(connection.header_skipped);
+  EXPECT_EQ(kHeader.length(), kBodyOffset);
+  EXPECT_EQ("body", string(static_cast<char*>(buffer) + kBodyOffset,
+                           buffer.length() - kBodyOffset));
+  // Received data is not moved.
+  EXPECT_EQ(kHeader.length() + 4, buffer.length());
+  EXPECT_TRUE(connection.keep_alive);
+}
+
+TEST_F(HttpTransceiverTest, skip_header_should_keep_header_split_between_blocks)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nContent-Le"));
+  EXPECT_EQ(buffer.length(), transceiver.skip_header(buffer, connection));
+  EXPECT_FALSE(connection.header_skipped);
+
+  buffer = string("ngth: 4\r\n\r\nbody");
+  const size_t kBodyOffset = transceiver.skip_header(buffer, connection);
+
+  EXPECT_TRUE(connection.header_skipped);
+  EXPECT_EQ("body", string(static_cast<char*>(buffer) + kBodyOffset,
+                           buffer.length() - kBodyOffset));
+  EXPECT_EQ(4, connection.response_parser.get_content_length());
+}
+
+TEST_F(HttpTransceiverTest, connection_close_should_disable_keep_alive)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\n"
+                       "CONNECTION: Close\r\n\r\n"));
+  EXPECT_EQ(buffer.length(), transceiver.skip_header(buffer, connection));
+
+  EXPECT_TRUE(connection.header_skipped);
+  EXPECT_FALSE(connection.keep_alive);
+}
+
+TEST_F(HttpTransceiverTest, http_1_0_response_should_disable_keep_alive)
+{
+  Buffer buffer(string("HTTP/1.0 200 OK\r\n\r\n"));
+  transceiver.skip_header(buffer, connection);
+
+  EXPECT_FALSE(connection.keep_alive);
+}
+
+TEST_F(HttpTransceiverTest, decode_body_should_strip_chunk_framing)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                       "4\r\nbody\r\n0\r\n\r\n"));
+  const size_t kBodyOffset = transceiver.skip_header(buffer, connection);
+  char* body = static_cast<char*>(buffer) + kBodyOffset;
+  const size_t kBodyLength = transceiver.decode_body(
+      body, buffer.length() - kBodyOffset, connection);
+
+  EXPECT_EQ("body", string(body, kBodyLength));
+  EXPECT_TRUE(connection.end_of_body);
+  // Chunk framing may be left unread by ranged requests.
+  EXPECT_FALSE(connection.keep_alive);
+}
+
+TEST_F(HttpTransceiverTest, closing_should_end_body_of_unknown_length)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\n\r\nbody"));
+  transceiver.skip_header(buffer, connection);
+  EXPECT_FALSE(connection.end_of_body);
+
+  transceiver.on_connection_closed(connection);
+  EXPECT_TRUE(connection.end_of_body);
+}
+
+TEST_F(HttpTransceiverTest, closing_should_not_end_body_of_known_length)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nbody"));
+  transceiver.skip_header(buffer, connection);
+  transceiver.on_connection_closed(connection);
+
+  EXPECT_FALSE(connection.end_of_body);
+  EXPECT_EQ(OperationStatus::SOCKET_RECV_ERROR, connection.status);
+}
+
+TEST_F(HttpTransceiverTest, body_of_known_length_should_end_with_its_last_byte)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nContent-Length: 8\r\n\r\nbody"));
+  const size_t kBodyOffset = transceiver.skip_header(buffer, connection);
+  char* body = static_cast<char*>(buffer) + kBodyOffset;
+  transceiver.decode_body(body, buffer.length() - kBodyOffset, connection);
+  EXPECT_FALSE(connection.end_of_body);
+
+  buffer = string("body");
+  transceiver.decode_body(buffer, buffer.length(), connection);
+  EXPECT_TRUE(connection.end_of_body);
+
+  transceiver.on_connection_closed(connection);
+  EXPECT_EQ(OperationStatus::NOT_STARTED, connection.status);
+}
+
+TEST_F(HttpTransceiverTest, closing_truncated_chunked_body_should_fail_connection)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                       "4\r\nbody\r\n8\r\nbo"));
+  const size_t kBodyOffset = transceiver.skip_header(buffer, connection);
+  char* body = static_cast<char*>(buffer) + kBodyOffset;
+  EXPECT_EQ(6, transceiver.decode_body(body, buffer.length() - kBodyOffset,
+                                       connection));
+
+  transceiver.on_connection_closed(connection);
+  EXPECT_FALSE(connection.end_of_body);
+  EXPECT_EQ(OperationStatus::SOCKET_RECV_ERROR, connection.status);
+}
+
+TEST_F(HttpTransceiverTest, malformed_chunk_size_should_fail_connection)
+{
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                       "4\r\nbody\r\nzz\r\nbody\r\n0\r\n\r\n"));
+  const size_t kBodyOffset = transceiver.skip_header(buffer, connection);
+  char* body = static_cast<char*>(buffer) + kBodyOffset;
+  transceiver.decode_body(body, buffer.length() - kBodyOffset, connection);
+
+  EXPECT_FALSE(connection.end_of_body);
+  EXPECT_FALSE(connection.keep_alive);
+  EXPECT_EQ(OperationStatus::RESPONSE_ERROR, connection.status);
+}
+
+TEST_F(HttpTransceiverTest, whole_file_response_should_be_rejected_for_later_chunk)
+{
+  connection.chunk = Chunk(1000, 1001, 1999);
+  Buffer buffer(string("HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nbody"));
+
+  EXPECT_EQ(buffer.length(), transceiver.skip_header(buffer, connection));
+  EXPECT_FALSE(connection.header_skipped);
+  EXPECT_FALSE(connection.keep_alive);
+
+  // Rest of response is dropped too.
+  buffer = string("body");
+  EXPECT_EQ(buffer.length(), transceiver.skip_header(buffer, connection));
+}
+
+TEST_F(HttpTransceiverTest, content_range_should_start_at_chunk_position)
+{
+  connection.chunk = Chunk(1000, 1001, 1999);
+  Buffer buffer(string("HTTP/1.1 206 Partial Content\r\n"
+                       "Content-Range: bytes 1001-1999/5000\r\n\r\n"));
+  transceiver.skip_header(buffer, connection);
+  EXPECT_TRUE(connection.header_skipped);
+
+  Connection other_connection;
+  other_connection.chunk = Chunk(1000, 1001, 1999);
+  buffer = string("HTTP/1.1 206 Partial Content\r\n"
+                  "Content-Range: bytes 0-998/5000\r\n\r\n");
+  transceiver.skip_header(buffer, other_connection);
+  EXPECT_FALSE(other_connection.header_skipped);
+}
@@ -29,3 +29,11 @@ TEST(UnitsOperatorTest, _GB_operator_should_return_input_x_2_pow_30)
   EXPECT_EQ(1000 * pow(2, 30), 1000_GB);
 }
 
+TEST(UnitsOperatorTest, _TB_operator_should_return_input_x_2_pow_40)
+{
+  EXPECT_EQ(0, 0_TB);
+  EXPECT_EQ(pow(2, 40), 1_TB);
+  EXPECT_EQ(2 * pow(2, 40), 2_TB);
+  EXPECT_EQ(3 * pow(2, 40), 3_TB);
+  EXPECT_EQ(1000 * pow(2, 40), 1000_TB);
+}
@@ -0,0 +1,105 @@
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "uring_queue.h"
+
+using namespace std;
+
+class UringQueueTest : public ::testing::Test
+{
+  void SetUp()
+  {
+    if (!UringQueue::available())
+      GTEST_SKIP() << "io_uring is not available.";
+
+    uring = make_unique<UringQueue>(8);
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    file_desc = open(TEST_FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_NE(-1, file_desc);
+  }
+
+  void TearDown()
+  {
+    if (!uring)
+      return;
+    close(sockets[0]);
+    close(sockets[1]);
+    close(file_desc);
+    unlink(TEST_FILE_NAME);
+  }
+
+  protected:
+    static constexpr char TEST_FILE_NAME[] = "URING_TEST_FILE";
+    unique_ptr<UringQueue> uring;
+    vector<UringQueue::Completion> completions;
+    int sockets[2];
+    int file_desc;
+};
+
+TEST_F(UringQueueTest, wait_should_timeout_without_submissions)
+{
+  EXPECT_EQ(0, uring->submit_and_wait(completions, 10));
+}
+
+TEST_F(UringQueueTest, received_data_should_be_reported_with_user_data)
+{
+  static constexpr char kData[] = "received data";
+  char buffer[64];
+  ASSERT_TRUE(uring->prepare_recv(sockets[0], buffer, sizeof(buffer), 42));
+  ASSERT_EQ(strlen(kData), write(sockets[1], kData, strlen(kData)));
+
+  ASSERT_EQ(1, uring->submit_and_wait(completions, 1000));
+  EXPECT_EQ(42, completions[0].user_data);
+  EXPECT_EQ(strlen(kData), completions[0].result);
+  EXPECT_EQ(0, strncmp(kData, buffer, strlen(kData)));
+}
+
+TEST_F(UringQueueTest, written_data_should_be_placed_at_given_offset)
+{
+  static constexpr char kData[] = "positioned";
+  static constexpr size_t kOffset = 100;
+  ASSERT_TRUE(uring->prepare_write(file_desc, kData, strlen(kData), kOffset, 7));
+
+  ASSERT_EQ(1, uring->submit_and_wait(completions, 1000));
+  EXPECT_EQ(7, completions[0].user_data);
+  EXPECT_EQ(strlen(kData), completions[0].result);
+
+  char read_buffer[sizeof(kData)] = {};
+  ASSERT_EQ(strlen(kData), pread(file_desc, read_buffer, strlen(kData), kOffset));
+  EXPECT_STREQ(kData, read_buffer);
+}
+
+TEST_F(UringQueueTest, poll_should_complete_when_descriptor_is_readable)
+{
+  ASSERT_TRUE(uring->prepare_poll(sockets[0], 9));
+  EXPECT_EQ(0, uring->submit_and_wait(completions, 10));
+
+  ASSERT_EQ(1, write(sockets[1], "x", 1));
+  ASSERT_EQ(1, uring->submit_and_wait(completions, 1000));
+  EXPECT_EQ(9, completions[0].user_data);
+  EXPECT_TRUE(completions[0].result & POLLIN);
+}
+
+TEST_F(UringQueueTest, full_submission_queue_should_be_submitted_implicitly)
+{
+  static constexpr size_t kWrites = 32;
+  static constexpr char kData[] = "x";
+  for (size_t i = 0; i < kWrites; ++i)
+    ASSERT_TRUE(uring->prepare_write(file_desc, kData, 1, i, i));
+
+  size_t reaped = 0;
+  while (reaped < kWrites) {
+    int result = uring->submit_and_wait(completions, 1000);
+    ASSERT_GT(result, 0);
+    reaped += result;
+  }
+  EXPECT_EQ(kWrites, lseek(file_desc, 0, SEEK_END));
+}